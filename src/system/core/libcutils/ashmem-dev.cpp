@@ -44,6 +44,8 @@
 #include <android-base/strings.h>
 #include <android-base/unique_fd.h>
 
+#include "ashmem-pool.h"
+
 /* Will be added to UAPI once upstream change is merged */
 #define F_SEAL_FUTURE_WRITE 0x0010
 
@@ -466,3 +468,49 @@ int ashmem_get_size_region(int fd)
 
     return __ashmem_check_failure(fd, TEMP_FAILURE_RETRY(ioctl(fd, ASHMEM_GET_SIZE, NULL)));
 }
+
+bool ashmem_region_release(int fd, void* /*addr*/, size_t size, bool keep_pages) {
+    /* Pool regions are always created by ashmem_create_region(), so they are
+     * memfds exactly when has_memfd_support() says so.
+     */
+    if (has_memfd_support()) {
+        if (fcntl(fd, F_GET_SEALS) != 0) {
+            return false;
+        }
+        if (keep_pages) {
+            return true;
+        }
+        /* MADV_FREE only applies to private anonymous memory; punching a hole
+         * is how shared memory gives its pages back, though not lazily.
+         */
+        return fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, 0, size) == 0;
+    }
+
+    int prot = TEMP_FAILURE_RETRY(ioctl(fd, ASHMEM_GET_PROT_MASK));
+    if (prot < 0 || !(prot & PROT_WRITE)) {
+        return false;
+    }
+    if (keep_pages) {
+        return true;
+    }
+    /* Unpinned pages are only reclaimed under memory pressure. */
+    ashmem_pin pin = { 0, 0 };
+    return TEMP_FAILURE_RETRY(ioctl(fd, ASHMEM_UNPIN, &pin)) >= 0;
+}
+
+bool ashmem_region_reacquire(int fd, void* addr, size_t size, bool keep_pages) {
+    if (has_memfd_support() || keep_pages) {
+        return true;
+    }
+
+    ashmem_pin pin = { 0, 0 };
+    int ret = TEMP_FAILURE_RETRY(ioctl(fd, ASHMEM_PIN, &pin));
+    if (ret < 0) {
+        return false;
+    }
+    /* Purged pages read back as zeros; ones that survived must be cleared. */
+    if (ret == ASHMEM_NOT_PURGED) {
+        memset(addr, 0, size);
+    }
+    return true;
+}
@@ -34,6 +34,8 @@
 
 #include <utils/Compat.h>
 
+#include "ashmem-pool.h"
+
 static bool ashmem_validate_stat(int fd, struct stat* buf) {
     int result = fstat(fd, buf);
     if (result == -1) {
@@ -94,3 +96,14 @@ int ashmem_get_size_region(int fd)
 
     return buf.st_size;
 }
+
+bool ashmem_region_release(int fd, void* /*addr*/, size_t size, bool keep_pages) {
+    if (keep_pages) return true;
+    // Truncating the file frees its pages; growing it again reads as zeros.
+    return TEMP_FAILURE_RETRY(ftruncate(fd, 0)) == 0 &&
+           TEMP_FAILURE_RETRY(ftruncate(fd, size)) == 0;
+}
+
+bool ashmem_region_reacquire(int /*fd*/, void* /*addr*/, size_t /*size*/, bool /*keep_pages*/) {
+    return true;
+}
@@ -0,0 +1,184 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <cutils/ashmem.h>
+
+#include <errno.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "ashmem-pool.h"
+
+#if defined(__linux__) && !defined(MADV_POPULATE_WRITE)
+#define MADV_POPULATE_WRITE 23
+#endif
+
+// Regions are pooled in power-of-two size classes from one page up to this;
+// larger ones are created at their exact (page-rounded) size and never cached.
+static constexpr size_t kMaxClassShift = 26;  // 64MiB
+
+struct ashmem_pool {
+    std::string name;
+    size_t max_cached_bytes;
+    int flags;
+
+    std::mutex lock;
+    size_t cached_bytes = 0;  // Guarded by lock.
+    std::vector<ashmem_region> cached[kMaxClassShift + 1];  // Guarded by lock.
+};
+
+static size_t page_size() {
+    static const size_t page_size = getpagesize();
+    return page_size;
+}
+
+// Returns the size class that holds size bytes, or -1 if it's too big to pool.
+static int size_class(size_t size) {
+    size_t class_size = page_size();
+    for (int shift = __builtin_ctzl(class_size); shift <= static_cast<int>(kMaxClassShift);
+         ++shift, class_size <<= 1) {
+        if (size <= class_size) return shift;
+    }
+    return -1;
+}
+
+static void free_region(ashmem_region* region) {
+    munmap(region->addr, region->size);
+    close(region->fd);
+    region->fd = -1;
+    region->addr = nullptr;
+    region->size = 0;
+}
+
+static void prefault(void* addr, size_t len) {
+#if defined(__linux__)
+    static std::atomic<bool> populate_supported{true};
+    if (populate_supported.load(std::memory_order_relaxed)) {
+        if (madvise(addr, len, MADV_POPULATE_WRITE) == 0) return;
+        if (errno == EINVAL) populate_supported.store(false, std::memory_order_relaxed);
+    }
+#endif
+    // Write each page's first byte back to itself: that faults it in for
+    // writing without changing what it holds.
+    volatile char* p = static_cast<volatile char*>(addr);
+    for (size_t offset = 0; offset < len; offset += page_size()) {
+        p[offset] = p[offset];
+    }
+}
+
+struct ashmem_pool* ashmem_pool_create(const char* name, size_t max_cached_bytes, int flags) {
+    if (flags & ~(ASHMEM_POOL_PREFAULT | ASHMEM_POOL_KEEP_PAGES)) {
+        errno = EINVAL;
+        return nullptr;
+    }
+    ashmem_pool* pool = new ashmem_pool;
+    pool->name = name ? name : "";
+    pool->max_cached_bytes = max_cached_bytes;
+    pool->flags = flags;
+    return pool;
+}
+
+void ashmem_pool_destroy(struct ashmem_pool* pool) {
+    if (!pool) return;
+    for (auto& regions : pool->cached) {
+        for (ashmem_region& region : regions) free_region(&region);
+    }
+    delete pool;
+}
+
+int ashmem_pool_get(struct ashmem_pool* pool, size_t size, struct ashmem_region* region) {
+    if (size == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    bool keep_pages = pool->flags & ASHMEM_POOL_KEEP_PAGES;
+    int shift = size_class(size);
+
+    while (shift >= 0) {
+        {
+            std::lock_guard<std::mutex> lock(pool->lock);
+            if (pool->cached[shift].empty()) break;
+            *region = pool->cached[shift].back();
+            pool->cached[shift].pop_back();
+            pool->cached_bytes -= region->size;
+        }
+        if (ashmem_region_reacquire(region->fd, region->addr, region->size, keep_pages)) {
+            if (pool->flags & ASHMEM_POOL_PREFAULT) prefault(region->addr, size);
+            return 0;
+        }
+        free_region(region);
+    }
+
+    size_t region_size = shift >= 0 ? size_t(1) << shift
+                                    : (size + page_size() - 1) & ~(page_size() - 1);
+    int fd = ashmem_create_region(pool->name.empty() ? nullptr : pool->name.c_str(),
+                                  region_size);
+    if (fd < 0) return -1;
+    void* addr = mmap(nullptr, region_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) {
+        int saved_errno = errno;
+        close(fd);
+        errno = saved_errno;
+        return -1;
+    }
+    *region = { fd, addr, region_size };
+    if (pool->flags & ASHMEM_POOL_PREFAULT) prefault(addr, size);
+    return 0;
+}
+
+void ashmem_pool_put(struct ashmem_pool* pool, struct ashmem_region* region) {
+    if (region->fd < 0) return;
+
+    int shift = size_class(region->size);
+    if (shift < 0 || region->size != size_t(1) << shift) {
+        free_region(region);
+        return;
+    }
+
+    // Reserve room in the cache before paying to release the pages.
+    bool fits;
+    {
+        std::lock_guard<std::mutex> lock(pool->lock);
+        fits = pool->cached_bytes + region->size <= pool->max_cached_bytes;
+        if (fits) pool->cached_bytes += region->size;
+    }
+    if (!fits) {
+        free_region(region);
+        return;
+    }
+
+    bool keep_pages = pool->flags & ASHMEM_POOL_KEEP_PAGES;
+    bool reusable = ashmem_region_release(region->fd, region->addr, region->size, keep_pages);
+    {
+        std::lock_guard<std::mutex> lock(pool->lock);
+        if (reusable) {
+            pool->cached[shift].push_back(*region);
+        } else {
+            pool->cached_bytes -= region->size;
+        }
+    }
+    if (reusable) {
+        *region = { -1, nullptr, 0 };
+    } else {
+        free_region(region);
+    }
+}
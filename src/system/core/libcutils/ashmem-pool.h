@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef __ASHMEM_POOL_H
+#define __ASHMEM_POOL_H
+
+#include <stddef.h>
+
+/*
+ * What ashmem-pool.cpp needs from the device (ashmem-dev.cpp) or host
+ * (ashmem-host.cpp) implementation to recycle a region.
+ */
+
+/*
+ * Called when a region is returned to a pool. Returns false if the region
+ * can't be reused (it was sealed or write-protected). Unless keep_pages is
+ * set, also releases the region's pages, lazily where possible.
+ */
+bool ashmem_region_release(int fd, void* addr, size_t size, bool keep_pages);
+
+/*
+ * Called when a cached region is handed out again. Unless keep_pages is set,
+ * makes sure the region reads as zeros. Returns false if it can't be reused.
+ */
+bool ashmem_region_reacquire(int fd, void* addr, size_t size, bool keep_pages);
+
+#endif  // __ASHMEM_POOL_H
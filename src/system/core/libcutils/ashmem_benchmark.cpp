@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cutils/ashmem.h>
+
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <android-base/logging.h>
+#include <benchmark/benchmark.h>
+
+// Each iteration is one buffer's life: create it, map it, fill it, and
+// drop it again.
+
+static void BM_ashmem_unpooled(benchmark::State& state) {
+    size_t size = state.range(0);
+    while (state.KeepRunning()) {
+        int fd = ashmem_create_region("bench", size);
+        CHECK_GE(fd, 0);
+        void* addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        CHECK_NE(MAP_FAILED, addr);
+        memset(addr, 1, size);
+        munmap(addr, size);
+        close(fd);
+    }
+    state.SetBytesProcessed(state.iterations() * size);
+}
+BENCHMARK(BM_ashmem_unpooled)->Range(4096, 4 << 20);
+
+static void BM_ashmem_pooled(benchmark::State& state, int flags) {
+    size_t size = state.range(0);
+    ashmem_pool* pool = ashmem_pool_create("bench", 64 << 20, flags);
+    CHECK(pool != nullptr);
+    while (state.KeepRunning()) {
+        ashmem_region region;
+        CHECK_EQ(0, ashmem_pool_get(pool, size, &region));
+        memset(region.addr, 1, size);
+        ashmem_pool_put(pool, &region);
+    }
+    state.SetBytesProcessed(state.iterations() * size);
+    ashmem_pool_destroy(pool);
+}
+BENCHMARK_CAPTURE(BM_ashmem_pooled, discard, 0)->Range(4096, 4 << 20);
+BENCHMARK_CAPTURE(BM_ashmem_pooled, prefault, ASHMEM_POOL_PREFAULT)->Range(4096, 4 << 20);
+BENCHMARK_CAPTURE(BM_ashmem_pooled, keep_pages, ASHMEM_POOL_KEEP_PAGES)->Range(4096, 4 << 20);
+
+// Many buffers in flight at once, as a producer with a queue would have.
+static void BM_ashmem_burst(benchmark::State& state, bool pooled) {
+    constexpr size_t kSize = 64 * 1024;
+    constexpr int kCount = 32;
+    ashmem_pool* pool = pooled ? ashmem_pool_create("bench", 64 << 20, 0) : nullptr;
+    ashmem_region regions[kCount];
+    while (state.KeepRunning()) {
+        for (ashmem_region& region : regions) {
+            if (pooled) {
+                CHECK_EQ(0, ashmem_pool_get(pool, kSize, &region));
+            } else {
+                region.fd = ashmem_create_region("bench", kSize);
+                CHECK_GE(region.fd, 0);
+                region.addr = mmap(nullptr, kSize, PROT_READ | PROT_WRITE, MAP_SHARED,
+                                   region.fd, 0);
+                CHECK_NE(MAP_FAILED, region.addr);
+            }
+            memset(region.addr, 1, kSize);
+        }
+        for (ashmem_region& region : regions) {
+            if (pooled) {
+                ashmem_pool_put(pool, &region);
+            } else {
+                munmap(region.addr, kSize);
+                close(region.fd);
+            }
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kCount);
+    ashmem_pool_destroy(pool);
+}
+BENCHMARK_CAPTURE(BM_ashmem_burst, unpooled, false);
+BENCHMARK_CAPTURE(BM_ashmem_burst, pooled, true);
+
+BENCHMARK_MAIN();
@@ -19,6 +19,7 @@
 #include <stdint.h>
 #include <string.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 
@@ -275,3 +276,106 @@ TEST(AshmemTest, ForkMultiRegionTest) {
         EXPECT_EQ(0, munmap(region, size));
     }
 }
+
+static ino_t RegionInode(const ashmem_region& region) {
+    struct stat st;
+    EXPECT_EQ(0, fstat(region.fd, &st));
+    return st.st_ino;
+}
+
+static bool IsZero(const void* data, size_t len) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < len; i++) {
+        if (p[i]) return false;
+    }
+    return true;
+}
+
+TEST(AshmemTest, PoolReuseTest) {
+    ashmem_pool* pool = ashmem_pool_create("pool-test", 1024 * PAGE_SIZE, ASHMEM_POOL_PREFAULT);
+    ASSERT_NE(nullptr, pool);
+
+    ashmem_region region;
+    ASSERT_EQ(0, ashmem_pool_get(pool, PAGE_SIZE + 1, &region));
+    ASSERT_TRUE(ashmem_valid(region.fd));
+    ASSERT_EQ(2 * PAGE_SIZE, region.size);
+    ASSERT_EQ(region.size, static_cast<size_t>(ashmem_get_size_region(region.fd)));
+    ino_t inode = RegionInode(region);
+    memset(region.addr, 0xaa, region.size);
+    ashmem_pool_put(pool, &region);
+    EXPECT_EQ(-1, region.fd);
+
+    // The same size class comes back zero-filled.
+    ASSERT_EQ(0, ashmem_pool_get(pool, 2 * PAGE_SIZE, &region));
+    EXPECT_EQ(inode, RegionInode(region));
+    EXPECT_TRUE(IsZero(region.addr, region.size));
+
+    // A different one doesn't.
+    ashmem_region other;
+    ASSERT_EQ(0, ashmem_pool_get(pool, PAGE_SIZE, &other));
+    EXPECT_NE(inode, RegionInode(other));
+    EXPECT_EQ(PAGE_SIZE, other.size);
+
+    ashmem_pool_put(pool, &other);
+    ashmem_pool_put(pool, &region);
+    ashmem_pool_destroy(pool);
+}
+
+TEST(AshmemTest, PoolKeepPagesTest) {
+    ashmem_pool* pool = ashmem_pool_create(nullptr, 1024 * PAGE_SIZE, ASHMEM_POOL_KEEP_PAGES);
+    ASSERT_NE(nullptr, pool);
+
+    ashmem_region region;
+    ASSERT_EQ(0, ashmem_pool_get(pool, PAGE_SIZE, &region));
+    memset(region.addr, 0xaa, region.size);
+    ashmem_pool_put(pool, &region);
+
+    ASSERT_EQ(0, ashmem_pool_get(pool, PAGE_SIZE, &region));
+    EXPECT_EQ(0xaa, static_cast<uint8_t*>(region.addr)[PAGE_SIZE - 1]);
+
+    ashmem_pool_put(pool, &region);
+    ashmem_pool_destroy(pool);
+}
+
+TEST(AshmemTest, PoolProtectedNotReusedTest) {
+    ashmem_pool* pool = ashmem_pool_create(nullptr, 1024 * PAGE_SIZE, 0);
+    ASSERT_NE(nullptr, pool);
+
+    ashmem_region region;
+    ASSERT_EQ(0, ashmem_pool_get(pool, PAGE_SIZE, &region));
+    ino_t inode = RegionInode(region);
+    // Hold the region open, so its inode can't be recycled if it's freed.
+    unique_fd held(dup(region.fd));
+    ASSERT_EQ(0, ashmem_set_prot_region(region.fd, PROT_READ));
+    ashmem_pool_put(pool, &region);
+
+    ASSERT_EQ(0, ashmem_pool_get(pool, PAGE_SIZE, &region));
+    EXPECT_NE(inode, RegionInode(region));
+
+    ashmem_pool_put(pool, &region);
+    ashmem_pool_destroy(pool);
+}
+
+TEST(AshmemTest, PoolLimitTest) {
+    ashmem_pool* pool = ashmem_pool_create(nullptr, PAGE_SIZE, 0);
+    ASSERT_NE(nullptr, pool);
+
+    ashmem_region small, big;
+    ASSERT_EQ(0, ashmem_pool_get(pool, PAGE_SIZE, &small));
+    ASSERT_EQ(0, ashmem_pool_get(pool, 2 * PAGE_SIZE, &big));
+    ino_t small_inode = RegionInode(small);
+    ino_t big_inode = RegionInode(big);
+    unique_fd held(dup(big.fd));
+
+    // Only the region that fits under the limit is kept.
+    ashmem_pool_put(pool, &big);
+    ashmem_pool_put(pool, &small);
+    ASSERT_EQ(0, ashmem_pool_get(pool, PAGE_SIZE, &small));
+    ASSERT_EQ(0, ashmem_pool_get(pool, 2 * PAGE_SIZE, &big));
+    EXPECT_EQ(small_inode, RegionInode(small));
+    EXPECT_NE(big_inode, RegionInode(big));
+
+    ashmem_pool_put(pool, &small);
+    ashmem_pool_put(pool, &big);
+    ashmem_pool_destroy(pool);
+}
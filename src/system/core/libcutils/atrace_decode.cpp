@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Converts the output of atrace_set_binary_fd() to systrace text.
+//
+// usage: atrace_decode [INPUT [OUTPUT]]
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <string>
+
+#include <android-base/file.h>
+
+#include "trace-binary.h"
+
+int main(int argc, char** argv) {
+    if (argc > 3) {
+        fprintf(stderr, "usage: %s [INPUT [OUTPUT]]\n", argv[0]);
+        return 1;
+    }
+
+    std::string in;
+    bool read_ok = argc > 1 ? android::base::ReadFileToString(argv[1], &in)
+                            : android::base::ReadFdToString(STDIN_FILENO, &in);
+    if (!read_ok) {
+        fprintf(stderr, "%s: couldn't read %s: %s\n", argv[0], argc > 1 ? argv[1] : "stdin",
+                strerror(errno));
+        return 1;
+    }
+
+    std::string out;
+    bool decode_ok = atrace_binary_to_systrace(in, &out);
+    bool write_ok = argc > 2 ? android::base::WriteStringToFile(out, argv[2])
+                             : android::base::WriteStringToFd(out, STDOUT_FILENO);
+    if (!write_ok) {
+        fprintf(stderr, "%s: couldn't write output: %s\n", argv[0], strerror(errno));
+        return 1;
+    }
+    if (!decode_ok) {
+        fprintf(stderr, "%s: input is truncated or malformed\n", argv[0]);
+        return 1;
+    }
+    return 0;
+}
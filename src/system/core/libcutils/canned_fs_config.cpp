@@ -19,30 +19,91 @@
 #include <private/fs_config.h>
 
 #include <errno.h>
+#include <fcntl.h>
 #include <inttypes.h>
 #include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#endif
+
+#include <string>
+#include <vector>
+
+#if !defined(O_BINARY)
+#define O_BINARY 0
+#endif
+
+/*
+ * The binary form of a canned fs_config, which load_canned_fs_config() maps
+ * instead of parsing. Everything is in the build host's byte order:
+ *
+ *   CannedHeader
+ *   uint32_t index[buckets]     entry number + 1, or 0 for an empty bucket
+ *   CannedEntry entries[count]
+ *   char paths[]                NUL terminated, without the leading '/'
+ *
+ * index is an open-addressed hash table of the paths, probed linearly from
+ * canned_hash(path) & (buckets - 1). buckets is a power of two larger than
+ * count, so there is always an empty bucket to stop at.
+ */
+static const char kCannedMagic[8] = {'\x7f', 'C', 'F', 'S', 'C', 1, 0, 0};
+
+typedef struct {
+    char magic[8];
+    uint32_t count;
+    uint32_t buckets;
+} CannedHeader;
 
 typedef struct {
-    const char* path;
-    unsigned uid;
-    unsigned gid;
-    unsigned mode;
     uint64_t capabilities;
-} Path;
+    uint32_t path;  // offset into paths
+    uint32_t hash;
+    uint32_t uid;
+    uint32_t gid;
+    uint32_t mode;
+    uint32_t reserved;
+} CannedEntry;
+
+static_assert(sizeof(CannedHeader) % 8 == 0, "entries must stay aligned");
+static_assert(sizeof(CannedEntry) == 32, "CannedEntry is part of the file format");
 
-static Path* canned_data = NULL;
-static int canned_alloc = 0;
-static int canned_used = 0;
+// The loaded config: a mapped binary file, or an image built from text.
+static struct {
+    const CannedHeader* header;
+    const uint32_t* index;
+    const CannedEntry* entries;
+    const char* paths;
+    size_t paths_size;
+    // Exactly one of these holds the data.
+    void* mapped;
+    size_t mapped_size;
+    std::string* image;
+} canned;
 
-static int path_compare(const void* a, const void* b) {
-    return strcmp(((Path*)a)->path, ((Path*)b)->path);
+// FNV-1a
+__attribute__((no_sanitize("integer")))
+static uint32_t canned_hash(const char* path) {
+    uint32_t hash = 2166136261u;
+    for (; *path; path++) {
+        hash = (hash ^ static_cast<uint8_t>(*path)) * 16777619u;
+    }
+    return hash;
 }
 
-int load_canned_fs_config(const char* fn) {
+/*
+ * Parses a text canned fs_config into the binary form. Later lines for the
+ * same path replace earlier ones.
+ */
+static int build_canned_image(const char* fn, std::string* image) {
     char buf[PATH_MAX + 200];
+    std::vector<CannedEntry> entries;
+    std::string paths;
+    int line_number = 0;
     FILE* f;
 
     f = fopen(fn, "r");
@@ -52,52 +113,222 @@ int load_canned_fs_config(const char* fn) {
     }
 
     while (fgets(buf, sizeof(buf), f)) {
-        Path* p;
-        char* token;
+        CannedEntry e = {};
         char* line = buf;
+        char* token;
+        char* uid;
+        char* gid;
+        char* mode;
         bool rootdir;
 
-        while (canned_used >= canned_alloc) {
-            canned_alloc = (canned_alloc+1) * 2;
-            canned_data = (Path*) realloc(canned_data, canned_alloc * sizeof(Path));
-        }
-        p = canned_data + canned_used;
+        line_number++;
+        if (line[0] == '\n' || line[0] == '\0') continue;
         if (line[0] == '/') line++;
         rootdir = line[0] == ' ';
-        p->path = strdup(rootdir ? "" : strtok(line, " "));
-        p->uid = atoi(strtok(rootdir ? line : NULL, " "));
-        p->gid = atoi(strtok(NULL, " "));
-        p->mode = strtol(strtok(NULL, " "), NULL, 8);   // mode is in octal
-        p->capabilities = 0;
+        token = rootdir ? NULL : strtok(line, " ");
+        uid = strtok(rootdir ? line : NULL, " ");
+        gid = strtok(NULL, " ");
+        mode = strtok(NULL, " ");
+        if ((!rootdir && !token) || !uid || !gid || !mode) {
+            fprintf(stderr, "%s:%d: malformed line\n", fn, line_number);
+            fclose(f);
+            return -1;
+        }
+        e.path = paths.size();
+        paths.append(rootdir ? "" : token);
+        paths.push_back('\0');
+        e.uid = atoi(uid);
+        e.gid = atoi(gid);
+        e.mode = strtol(mode, NULL, 8);  // mode is in octal
 
         do {
             token = strtok(NULL, " ");
             if (token && strncmp(token, "capabilities=", 13) == 0) {
-                p->capabilities = strtoll(token+13, NULL, 0);
+                e.capabilities = strtoll(token+13, NULL, 0);
                 break;
             }
         } while (token);
 
-        canned_used++;
+        e.hash = canned_hash(paths.data() + e.path);
+        entries.push_back(e);
     }
 
     fclose(f);
 
-    qsort(canned_data, canned_used, sizeof(Path), path_compare);
-    printf("loaded %d fs_config entries\n", canned_used);
+    uint32_t buckets = 2;
+    while (buckets < entries.size() * 2) buckets *= 2;
+    std::vector<uint32_t> index(buckets);
+    for (uint32_t n = 1; n <= entries.size(); n++) {
+        const CannedEntry& e = entries[n - 1];
+        for (uint32_t i = e.hash & (buckets - 1);; i = (i + 1) & (buckets - 1)) {
+            if (index[i] == 0 || (entries[index[i] - 1].hash == e.hash &&
+                                  strcmp(&paths[entries[index[i] - 1].path], &paths[e.path]) == 0)) {
+                index[i] = n;
+                break;
+            }
+        }
+    }
+
+    CannedHeader header = {};
+    memcpy(header.magic, kCannedMagic, sizeof(kCannedMagic));
+    header.count = entries.size();
+    header.buckets = buckets;
+
+    image->clear();
+    image->reserve(sizeof(header) + buckets * sizeof(uint32_t) +
+                   entries.size() * sizeof(CannedEntry) + paths.size());
+    image->append(reinterpret_cast<const char*>(&header), sizeof(header));
+    image->append(reinterpret_cast<const char*>(index.data()), buckets * sizeof(uint32_t));
+    image->append(reinterpret_cast<const char*>(entries.data()),
+                  entries.size() * sizeof(CannedEntry));
+    image->append(paths);
+    return 0;
+}
+
+static void unload_canned_fs_config() {
+#if !defined(_WIN32)
+    if (canned.mapped) munmap(canned.mapped, canned.mapped_size);
+#endif
+    delete canned.image;
+    memset(&canned, 0, sizeof(canned));
+}
+
+/*
+ * Checks that data holds a complete binary config, and makes it the loaded
+ * one. On success the config owns either the mapping or the image.
+ */
+static int use_canned_image(const void* data, size_t size, bool mapped, std::string* image) {
+    const CannedHeader* header = static_cast<const CannedHeader*>(data);
+    const char* p = static_cast<const char*>(data);
+
+    if (size < sizeof(CannedHeader) || memcmp(header->magic, kCannedMagic, sizeof(kCannedMagic)) ||
+        header->buckets <= header->count || (header->buckets & (header->buckets - 1)) != 0) {
+        return -1;
+    }
+    size_t paths_offset = sizeof(CannedHeader) + header->buckets * sizeof(uint32_t) +
+                          static_cast<size_t>(header->count) * sizeof(CannedEntry);
+    // The paths must end in a NUL, so lookups can't run off the end.
+    if (paths_offset > size || (paths_offset == size ? header->count != 0 : p[size - 1] != '\0')) {
+        return -1;
+    }
+
+    unload_canned_fs_config();
+    canned.header = header;
+    canned.index = reinterpret_cast<const uint32_t*>(p + sizeof(CannedHeader));
+    canned.entries = reinterpret_cast<const CannedEntry*>(canned.index + header->buckets);
+    canned.paths = p + paths_offset;
+    canned.paths_size = size - paths_offset;
+    if (mapped) {
+        canned.mapped = const_cast<void*>(data);
+        canned.mapped_size = size;
+    }
+    canned.image = image;
+    return 0;
+}
+
+// Maps fn if it is a binary config. Returns 1 if it is a text config instead.
+static int map_canned_image(const char* fn) {
+    char magic[sizeof(kCannedMagic)];
+    struct stat st;
+    int rc = -1;
+
+    int fd = open(fn, O_RDONLY | O_BINARY);
+    if (fd < 0) {
+        fprintf(stderr, "failed to open %s: %s\n", fn, strerror(errno));
+        return -1;
+    }
+    if (fstat(fd, &st) != 0 || read(fd, magic, sizeof(magic)) != sizeof(magic) ||
+        memcmp(magic, kCannedMagic, sizeof(magic)) != 0) {
+        close(fd);
+        return 1;
+    }
 
+#if !defined(_WIN32)
+    void* data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data != MAP_FAILED) {
+        rc = use_canned_image(data, st.st_size, true, NULL);
+        if (rc != 0) munmap(data, st.st_size);
+    }
+#else
+    std::string* image = new std::string(st.st_size, '\0');
+    if (lseek(fd, 0, SEEK_SET) == 0 && read(fd, &(*image)[0], st.st_size) == st.st_size) {
+        rc = use_canned_image(image->data(), image->size(), false, image);
+    }
+    if (rc != 0) delete image;
+#endif
+    close(fd);
+    if (rc != 0) {
+        fprintf(stderr, "failed to load %s: not a valid binary canned fs_config\n", fn);
+    }
+    return rc;
+}
+
+int load_canned_fs_config(const char* fn) {
+    int rc = map_canned_image(fn);
+    if (rc <= 0) {
+        if (rc == 0) printf("loaded %" PRIu32 " fs_config entries\n", canned.header->count);
+        return rc;
+    }
+
+    std::string* image = new std::string;
+    if (build_canned_image(fn, image) != 0 ||
+        use_canned_image(image->data(), image->size(), false, image) != 0) {
+        delete image;
+        return -1;
+    }
+    printf("loaded %" PRIu32 " fs_config entries\n", canned.header->count);
+
+    return 0;
+}
+
+int compile_canned_fs_config(const char* text_fn, const char* binary_fn) {
+    std::string image;
+    if (build_canned_image(text_fn, &image) != 0) {
+        return -1;
+    }
+
+    FILE* f = fopen(binary_fn, "wb");
+    if (f == NULL) {
+        fprintf(stderr, "failed to open %s: %s\n", binary_fn, strerror(errno));
+        return -1;
+    }
+    bool ok = fwrite(image.data(), 1, image.size(), f) == image.size();
+    if (fclose(f) != 0 || !ok) {
+        fprintf(stderr, "failed to write %s: %s\n", binary_fn, strerror(errno));
+        return -1;
+    }
     return 0;
 }
 
+static const CannedEntry* find_canned_entry(const char* path) {
+    if (canned.header == NULL) {
+        return NULL;
+    }
+    uint32_t hash = canned_hash(path);
+    uint32_t mask = canned.header->buckets - 1;
+    uint32_t i = hash & mask;
+    for (uint32_t probes = 0; probes < canned.header->buckets; probes++, i = (i + 1) & mask) {
+        uint32_t n = canned.index[i];
+        if (n == 0 || n > canned.header->count) {
+            return NULL;
+        }
+        const CannedEntry* e = &canned.entries[n - 1];
+        if (e->hash == hash && e->path < canned.paths_size &&
+            strcmp(canned.paths + e->path, path) == 0) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
 static const int kDebugCannedFsConfig = 0;
 
 void canned_fs_config(const char* path, int dir, const char* target_out_path,
                       unsigned* uid, unsigned* gid, unsigned* mode, uint64_t* capabilities) {
-    Path key, *p;
+    const CannedEntry* p;
 
-    key.path = path;
-    if (path[0] == '/') key.path++; // canned paths lack the leading '/'
-    p = (Path*) bsearch(&key, canned_data, canned_used, sizeof(Path), path_compare);
+    // canned paths lack the leading '/'
+    p = find_canned_entry(path[0] == '/' ? path + 1 : path);
     if (p == NULL) {
         fprintf(stderr, "failed to find [%s] in canned fs_config\n", path);
         exit(1);
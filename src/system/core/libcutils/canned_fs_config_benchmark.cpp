@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <private/canned_fs_config.h>
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <android-base/file.h>
+#include <android-base/logging.h>
+#include <android-base/stringprintf.h>
+#include <benchmark/benchmark.h>
+
+using android::base::StringAppendF;
+using android::base::StringPrintf;
+
+static constexpr size_t kEntries = 1000000;
+
+// A synthetic image: 1000 directories of 1000 files, in both forms.
+class Config {
+  public:
+    Config() {
+        std::string text;
+        for (size_t d = 0; d < kEntries / 1000; d++) {
+            for (size_t f = 0; f < 1000; f++) {
+                paths_.push_back(StringPrintf("system/app/App%zu/lib/arm64/libfile%zu.so", d, f));
+                StringAppendF(&text, "%s 0 0 644 capabilities=0\n", paths_.back().c_str());
+            }
+        }
+        CHECK(android::base::WriteStringToFile(text, text_.path));
+        CHECK_EQ(0, compile_canned_fs_config(text_.path, binary_.path));
+        std::shuffle(paths_.begin(), paths_.end(), std::mt19937(0));
+    }
+
+    const char* text_path() const { return text_.path; }
+    const char* binary_path() const { return binary_.path; }
+    const std::vector<std::string>& paths() const { return paths_; }
+
+  private:
+    TemporaryFile text_;
+    TemporaryFile binary_;
+    std::vector<std::string> paths_;
+};
+
+static const Config& GetConfig() {
+    static Config* config = new Config;
+    return *config;
+}
+
+static void BM_canned_fs_config_load(benchmark::State& state, bool binary) {
+    const Config& config = GetConfig();
+    const char* path = binary ? config.binary_path() : config.text_path();
+    while (state.KeepRunning()) {
+        CHECK_EQ(0, load_canned_fs_config(path));
+    }
+    state.SetItemsProcessed(state.iterations() * kEntries);
+}
+BENCHMARK_CAPTURE(BM_canned_fs_config_load, text, false)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_canned_fs_config_load, binary, true)->Unit(benchmark::kMillisecond);
+
+// Looks up every path in a random order, as an image build would.
+static void BM_canned_fs_config_lookup(benchmark::State& state) {
+    const Config& config = GetConfig();
+    CHECK_EQ(0, load_canned_fs_config(config.binary_path()));
+    unsigned uid, gid, mode;
+    uint64_t capabilities;
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        canned_fs_config(config.paths()[i].c_str(), 0, nullptr, &uid, &gid, &mode, &capabilities);
+        if (++i == config.paths().size()) i = 0;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_canned_fs_config_lookup);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,32 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Converts a text canned fs_config to the binary form, which
+// load_canned_fs_config() maps instead of parsing.
+//
+// usage: canned_fs_config_compile INPUT OUTPUT
+
+#include <stdio.h>
+
+#include <private/canned_fs_config.h>
+
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s INPUT OUTPUT\n", argv[0]);
+        return 1;
+    }
+    return compile_canned_fs_config(argv[1], argv[2]) == 0 ? 0 : 1;
+}
@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <private/canned_fs_config.h>
+
+#include <stdint.h>
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include <android-base/file.h>
+
+static const char kConfig[] =
+        " 0 0 755\n"
+        "system 0 0 755\n"
+        "system/bin 0 2000 751\n"
+        "system/bin/ping 0 2000 750 capabilities=0x2000\n"
+        "/vendor/lib/libfoo.so 1000 1000 644 selabel=u:object_r:foo:s0 capabilities=12\n"
+        "\n"
+        "system/bin/ping 0 2000 755\n";
+
+struct Entry {
+    unsigned uid;
+    unsigned gid;
+    unsigned mode;
+    uint64_t capabilities;
+};
+
+static Entry Lookup(const char* path) {
+    Entry e;
+    canned_fs_config(path, 0, nullptr, &e.uid, &e.gid, &e.mode, &e.capabilities);
+    return e;
+}
+
+static void CheckConfig() {
+    Entry e = Lookup("/");
+    EXPECT_EQ(0U, e.uid);
+    EXPECT_EQ(0755U, e.mode);
+
+    e = Lookup("system/bin");
+    EXPECT_EQ(2000U, e.gid);
+    EXPECT_EQ(0751U, e.mode);
+
+    // The last line for a path wins.
+    e = Lookup("/system/bin/ping");
+    EXPECT_EQ(0755U, e.mode);
+    EXPECT_EQ(0U, e.capabilities);
+
+    e = Lookup("vendor/lib/libfoo.so");
+    EXPECT_EQ(1000U, e.uid);
+    EXPECT_EQ(1000U, e.gid);
+    EXPECT_EQ(0644U, e.mode);
+    EXPECT_EQ(12U, e.capabilities);
+}
+
+TEST(canned_fs_config, text) {
+    TemporaryFile text;
+    ASSERT_TRUE(android::base::WriteStringToFile(kConfig, text.path));
+    ASSERT_EQ(0, load_canned_fs_config(text.path));
+    CheckConfig();
+}
+
+TEST(canned_fs_config, binary) {
+    TemporaryFile text;
+    TemporaryFile binary;
+    ASSERT_TRUE(android::base::WriteStringToFile(kConfig, text.path));
+    ASSERT_EQ(0, compile_canned_fs_config(text.path, binary.path));
+    ASSERT_EQ(0, load_canned_fs_config(binary.path));
+    CheckConfig();
+}
+
+TEST(canned_fs_config, truncated_binary) {
+    TemporaryFile text;
+    TemporaryFile binary;
+    ASSERT_TRUE(android::base::WriteStringToFile(kConfig, text.path));
+    ASSERT_EQ(0, compile_canned_fs_config(text.path, binary.path));
+
+    std::string image;
+    ASSERT_TRUE(android::base::ReadFileToString(binary.path, &image));
+    image.resize(image.size() / 2);
+    ASSERT_TRUE(android::base::WriteStringToFile(image, binary.path));
+    EXPECT_EQ(-1, load_canned_fs_config(binary.path));
+}
+
+TEST(canned_fs_config, malformed_text) {
+    TemporaryFile text;
+    ASSERT_TRUE(android::base::WriteStringToFile("system/bin 0 0\n", text.path));
+    EXPECT_EQ(-1, load_canned_fs_config(text.path));
+}
+
+TEST(canned_fs_config, missing_path) {
+    TemporaryFile text;
+    ASSERT_TRUE(android::base::WriteStringToFile(kConfig, text.path));
+    ASSERT_EQ(0, load_canned_fs_config(text.path));
+    ASSERT_EXIT(Lookup("system/xbin"), testing::ExitedWithCode(1), "failed to find");
+}
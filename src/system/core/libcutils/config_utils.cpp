@@ -18,10 +18,13 @@
 
 #include <string.h>
 #include <ctype.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <fcntl.h>
 #include <unistd.h>
 
+#include <vector>
+
 #include <cutils/misc.h>
 
 cnode* config_node(const char *name, const char *value)
@@ -116,6 +119,7 @@ typedef struct
     char *text;
     int len;
     char next;
+    config_arena *arena;    /* where to allocate nodes, or NULL for the heap */
 } cstate;
 
 static int _lex(cstate *cs, int value)
@@ -239,6 +243,148 @@ static int lex(cstate *cs, int value)
 #define lex(cs,v) _lex(cs,v)
 #endif
 
+/* Arena trees allocate this instead of a bare cnode, so that any node can
+ * carry an index of its children.
+ */
+struct arena_cnode
+{
+    cnode node;
+    uint32_t child_count;
+    uint32_t index_mask;    /* index size - 1, or 0 while not indexed */
+    cnode **index;          /* newest child for each name, open addressed */
+};
+
+/* Blocks with more children than this are indexed. */
+#define INDEX_MIN_CHILDREN 8
+
+#define ARENA_BLOCK_SIZE (64 * 1024)
+
+struct config_arena
+{
+    std::vector<char*> blocks;
+    char *next;
+    size_t left;
+    std::vector<mapped_file> files;
+    cnode *root;
+};
+
+static void* arena_alloc(config_arena *arena, size_t size)
+{
+    size = (size + sizeof(void*) - 1) & ~(sizeof(void*) - 1);
+    if(size > arena->left) {
+        /* Large requests (big indexes) get a block of their own. */
+        size_t block_size = size > ARENA_BLOCK_SIZE / 4 ? size : ARENA_BLOCK_SIZE;
+        char *block = static_cast<char*>(malloc(block_size));
+        if(!block) return NULL;
+        arena->blocks.push_back(block);
+        if(block_size != ARENA_BLOCK_SIZE) return block;
+        arena->next = block;
+        arena->left = block_size;
+    }
+    void *p = arena->next;
+    arena->next += size;
+    arena->left -= size;
+    return p;
+}
+
+/* FNV-1a */
+__attribute__((no_sanitize("integer")))
+static uint32_t name_hash(const char *name)
+{
+    uint32_t hash = 2166136261u;
+    while(*name) {
+        hash ^= static_cast<uint8_t>(*name++);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/* Makes child the indexed entry for its name, replacing any older one. */
+static void index_insert(arena_cnode *parent, cnode *child)
+{
+    uint32_t i = name_hash(child->name) & parent->index_mask;
+    while(parent->index[i] && strcmp(parent->index[i]->name, child->name))
+        i = (i + 1) & parent->index_mask;
+    parent->index[i] = child;
+}
+
+/* (Re)builds parent's index with room for twice its current children. */
+static bool index_build(config_arena *arena, arena_cnode *parent)
+{
+    uint32_t size = 16;
+    while(size < parent->child_count * 2)
+        size *= 2;
+    cnode **index = static_cast<cnode**>(arena_alloc(arena, size * sizeof(cnode*)));
+    if(!index) return false;
+    memset(index, 0, size * sizeof(cnode*));
+
+    parent->index = index;
+    parent->index_mask = size - 1;
+    for(cnode *node = parent->node.first_child; node; node = node->next)
+        index_insert(parent, node);
+    return true;
+}
+
+static arena_cnode* arena_node(config_arena *arena, const char *name)
+{
+    arena_cnode *node = static_cast<arena_cnode*>(arena_alloc(arena, sizeof(arena_cnode)));
+    if(node) {
+        memset(node, 0, sizeof(*node));
+        node->node.name = name ? name : "";
+        node->node.value = "";
+    }
+    return node;
+}
+
+static cnode* arena_create(config_arena *arena, cnode *root, const char *name)
+{
+    arena_cnode *node = arena_node(arena, name);
+    if(!node) return NULL;
+
+    arena_cnode *parent = reinterpret_cast<arena_cnode*>(root);
+    if(root->last_child)
+        root->last_child->next = &node->node;
+    else
+        root->first_child = &node->node;
+    root->last_child = &node->node;
+    parent->child_count++;
+
+    if(parent->index) {
+        /* Keep the index at most half full. */
+        if(parent->child_count * 2 > parent->index_mask + 1) {
+            if(!index_build(arena, parent)) parent->index = NULL;
+        } else {
+            index_insert(parent, &node->node);
+        }
+    } else if(parent->child_count > INDEX_MIN_CHILDREN) {
+        index_build(arena, parent);
+    }
+    return &node->node;
+}
+
+cnode* config_arena_find(cnode *root, const char *name)
+{
+    arena_cnode *parent = reinterpret_cast<arena_cnode*>(root);
+    if(!parent->index)
+        return config_find(root, name);
+
+    uint32_t i = name_hash(name) & parent->index_mask;
+    for(cnode *node; (node = parent->index[i]) != NULL; i = (i + 1) & parent->index_mask)
+        if(!strcmp(node->name, name))
+            return node;
+    return NULL;
+}
+
+static cnode* find_child(cstate *cs, cnode *root, const char *name)
+{
+    return cs->arena ? config_arena_find(root, name) : config_find(root, name);
+}
+
+static cnode* create_child(cstate *cs, cnode *root, const char *name)
+{
+    return cs->arena ? arena_create(cs->arena, root, name) : _config_create(root, name);
+}
+
 static int parse_expr(cstate *cs, cnode *node);
 
 static int parse_block(cstate *cs, cnode *node)
@@ -263,16 +409,20 @@ static int parse_expr(cstate *cs, cnode *root)
     cnode *node;
 
         /* last token was T_TEXT */
-    node = config_find(root, cs->text);
+    node = find_child(cs, root, cs->text);
     if(!node || *node->value)
-        node = _config_create(root, cs->text);
+        node = create_child(cs, root, cs->text);
+    if(!node)
+        return -1;
 
     for(;;) {
         switch(lex(cs, 1)) {
         case T_DOT:
             if(lex(cs, 0) != T_TEXT)
                 return -1;
-            node = _config_create(node, cs->text);
+            node = create_child(cs, node, cs->text);
+            if(!node)
+                return -1;
             continue;
 
         case T_TEXT:
@@ -288,12 +438,13 @@ static int parse_expr(cstate *cs, cnode *root)
     }
 }
 
-void config_load(cnode *root, char *data)
+static void load(config_arena *arena, cnode *root, char *data)
 {
     if(data != 0) {
         cstate cs;
         cs.data = data;
         cs.next = 0;
+        cs.arena = arena;
 
         for(;;) {
             switch(lex(&cs, 0)) {
@@ -308,10 +459,18 @@ void config_load(cnode *root, char *data)
     }
 }
 
+void config_load(cnode *root, char *data)
+{
+    load(NULL, root, data);
+}
+
 void config_load_file(cnode *root, const char *fn)
 {
-    char* data = static_cast<char*>(load_file(fn, nullptr));
-    config_load(root, data);
+    // The lexer terminates names and values in place, so map the file
+    // copy-on-write: only the pages it writes to get copied.
+    struct mapped_file file;
+    if (load_file_mapped(fn, &file, LOAD_FILE_WRITABLE) != 0) return;
+    config_load(root, file.data);
     // TODO: deliberate leak :-/
 }
 
@@ -326,3 +485,47 @@ void config_free(cnode *root)
         free(prev);
     }
 }
+
+config_arena* config_arena_create(void)
+{
+    config_arena *arena = new config_arena;
+    arena->next = NULL;
+    arena->left = 0;
+    arena_cnode *root = arena_node(arena, "");
+    if(!root) {
+        config_arena_free(arena);
+        return NULL;
+    }
+    arena->root = &root->node;
+    return arena;
+}
+
+cnode* config_arena_root(config_arena *arena)
+{
+    return arena->root;
+}
+
+void config_arena_load(config_arena *arena, char *data)
+{
+    load(arena, arena->root, data);
+}
+
+int config_arena_load_file(config_arena *arena, const char *fn)
+{
+    struct mapped_file file;
+    if(load_file_mapped(fn, &file, LOAD_FILE_WRITABLE) != 0)
+        return -1;
+    arena->files.push_back(file);
+    load(arena, arena->root, file.data);
+    return 0;
+}
+
+void config_arena_free(config_arena *arena)
+{
+    if(!arena) return;
+    for(char *block : arena->blocks)
+        free(block);
+    for(mapped_file &file : arena->files)
+        unload_file_mapped(&file);
+    delete arena;
+}
@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cutils/config_utils.h>
+
+#include <stdlib.h>
+
+#include <string>
+#include <vector>
+
+#include <android-base/logging.h>
+#include <android-base/stringprintf.h>
+#include <benchmark/benchmark.h>
+
+using android::base::StringAppendF;
+using android::base::StringPrintf;
+
+static constexpr int kKeys = 100000;
+
+// A config with kKeys keys: most in one wide block, some nested a level
+// deeper, and a few at the top level.
+static const std::string& Config() {
+    static const std::string config = [] {
+        std::string config = "# synthetic\nversion 1\nsettings {\n";
+        for (int i = 0; i < kKeys; i++) {
+            if (i % 10 == 0) {
+                StringAppendF(&config, "  group%d.key%d value %d\n", i % 100, i, i);
+            } else {
+                StringAppendF(&config, "  key%d value %d\n", i, i);
+            }
+        }
+        config += "}\n";
+        return config;
+    }();
+    return config;
+}
+
+static std::vector<char> Data() {
+    const std::string& config = Config();
+    std::vector<char> data(config.begin(), config.end());
+    data.push_back('\0');
+    return data;
+}
+
+static void BM_config_load(benchmark::State& state) {
+    while (state.KeepRunning()) {
+        state.PauseTiming();
+        std::vector<char> data = Data();
+        state.ResumeTiming();
+
+        cnode* root = config_node("", "");
+        config_load(root, data.data());
+        config_free(root);
+        free(root);
+    }
+    state.SetBytesProcessed(state.iterations() * Config().size());
+}
+BENCHMARK(BM_config_load)->Unit(benchmark::kMillisecond);
+
+static void BM_config_arena_load(benchmark::State& state) {
+    while (state.KeepRunning()) {
+        state.PauseTiming();
+        std::vector<char> data = Data();
+        state.ResumeTiming();
+
+        config_arena* arena = config_arena_create();
+        config_arena_load(arena, data.data());
+        config_arena_free(arena);
+    }
+    state.SetBytesProcessed(state.iterations() * Config().size());
+}
+BENCHMARK(BM_config_arena_load)->Unit(benchmark::kMillisecond);
+
+// Looks up keys spread across the wide block.
+static void BM_config_find(benchmark::State& state, bool arena_tree) {
+    std::vector<char> data = Data();
+    cnode* root = nullptr;
+    config_arena* arena = nullptr;
+    if (arena_tree) {
+        arena = config_arena_create();
+        config_arena_load(arena, data.data());
+        root = config_arena_root(arena);
+    } else {
+        root = config_node("", "");
+        config_load(root, data.data());
+    }
+
+    std::vector<std::string> keys;
+    for (int i = 1; i < kKeys; i += kKeys / 64) keys.push_back(StringPrintf("key%d", i));
+
+    cnode* settings = config_find(root, "settings");
+    CHECK(settings != nullptr);
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        const char* key = keys[i++ % keys.size()].c_str();
+        cnode* node = arena_tree ? config_arena_find(settings, key) : config_find(settings, key);
+        benchmark::DoNotOptimize(node);
+    }
+
+    if (arena_tree) {
+        config_arena_free(arena);
+    } else {
+        config_free(root);
+        free(root);
+    }
+}
+BENCHMARK_CAPTURE(BM_config_find, heap, false);
+BENCHMARK_CAPTURE(BM_config_find, arena, true);
+
+BENCHMARK_MAIN();
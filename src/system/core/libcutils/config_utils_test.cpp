@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cutils/config_utils.h>
+
+#include <stdlib.h>
+
+#include <string>
+#include <vector>
+
+#include <android-base/file.h>
+#include <android-base/stringprintf.h>
+#include <gtest/gtest.h>
+
+using android::base::StringPrintf;
+
+static const char kConfig[] =
+        "# comment\n"
+        "a 1\n"
+        "b {\n"
+        "  c two words \n"
+        "  d.e.f deep\n"
+        "}\n"
+        "a 2\n"
+        "b {\n"
+        "  c three\n"
+        "}\n";
+
+// Renders a tree, to compare trees built different ways.
+static void Dump(cnode* node, const std::string& indent, std::string* out) {
+    for (cnode* child = node->first_child; child; child = child->next) {
+        *out += indent + child->name + "=" + child->value + "\n";
+        Dump(child, indent + "  ", out);
+    }
+}
+
+TEST(ConfigUtilsTest, arena_matches_heap) {
+    std::string config = kConfig;
+    for (int i = 0; i < 100; i++) {
+        config += StringPrintf("wide {\n  k%d v%d\n}\nk%d %d\n", i % 37, i, i % 13, i);
+    }
+
+    std::vector<char> heap_data(config.begin(), config.end());
+    heap_data.push_back('\0');
+    cnode* heap = config_node("", "");
+    config_load(heap, heap_data.data());
+
+    std::vector<char> arena_data(config.begin(), config.end());
+    arena_data.push_back('\0');
+    config_arena* arena = config_arena_create();
+    ASSERT_NE(nullptr, arena);
+    config_arena_load(arena, arena_data.data());
+    cnode* root = config_arena_root(arena);
+
+    std::string heap_dump, arena_dump;
+    Dump(heap, "", &heap_dump);
+    Dump(root, "", &arena_dump);
+    EXPECT_EQ(heap_dump, arena_dump);
+
+    // Lookups agree too, indexed or not, including which duplicate wins.
+    for (int i = 0; i < 40; i++) {
+        std::string key = StringPrintf("k%d", i);
+        cnode* expected = config_find(heap, key.c_str());
+        cnode* actual = config_arena_find(root, key.c_str());
+        ASSERT_EQ(expected == nullptr, actual == nullptr) << key;
+        if (expected) {
+            EXPECT_STREQ(expected->value, actual->value) << key;
+        }
+    }
+    cnode* wide = config_arena_find(root, "wide");
+    ASSERT_NE(nullptr, wide);
+    EXPECT_STREQ("v99", config_arena_find(wide, "k25")->value);
+    EXPECT_EQ(nullptr, config_arena_find(wide, "k37"));
+
+    config_free(heap);
+    free(heap);
+    config_arena_free(arena);
+}
+
+TEST(ConfigUtilsTest, arena_values_point_into_data) {
+    std::vector<char> data(kConfig, kConfig + sizeof(kConfig));
+    config_arena* arena = config_arena_create();
+    ASSERT_NE(nullptr, arena);
+    config_arena_load(arena, data.data());
+
+    cnode* a = config_arena_find(config_arena_root(arena), "a");
+    ASSERT_NE(nullptr, a);
+    EXPECT_STREQ("2", a->value);
+    EXPECT_GE(a->value, data.data());
+    EXPECT_LT(a->value, data.data() + data.size());
+    config_arena_free(arena);
+}
+
+TEST(ConfigUtilsTest, arena_load_file) {
+    TemporaryFile tf;
+    ASSERT_TRUE(android::base::WriteStringToFile(kConfig, tf.path));
+
+    config_arena* arena = config_arena_create();
+    ASSERT_NE(nullptr, arena);
+    ASSERT_EQ(0, config_arena_load_file(arena, tf.path));
+    EXPECT_EQ(-1, config_arena_load_file(arena, "/does/not/exist"));
+
+    cnode* b = config_arena_find(config_arena_root(arena), "b");
+    ASSERT_NE(nullptr, b);
+    EXPECT_STREQ("three", config_str(b, "c", ""));
+    EXPECT_STREQ("2", config_str(config_arena_root(arena), "a", ""));
+    config_arena_free(arena);
+}
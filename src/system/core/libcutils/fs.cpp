@@ -34,13 +34,17 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <string>
+#include <vector>
+
 #include <log/log.h>
 
 #define ALL_PERMS (S_ISUID | S_ISGID | S_ISVTX | S_IRWXU | S_IRWXG | S_IRWXO)
 #define BUF_SIZE 64
 
-static int fs_prepare_path_impl(const char* path, mode_t mode, uid_t uid, gid_t gid,
-        int allow_fixup, int prepare_as_dir) {
+// Prepares name relative to dir_fd; path is only used in messages.
+static int fs_prepare_path_impl(int dir_fd, const char* name, const char* path, mode_t mode,
+        uid_t uid, gid_t gid, int allow_fixup, int prepare_as_dir) {
     // TODO: fix the goto hell below.
     int type_ok;
     int owner_match;
@@ -49,7 +53,7 @@ static int fs_prepare_path_impl(const char* path, mode_t mode, uid_t uid, gid_t
     // Check if path needs to be created
     struct stat sb;
     int create_result = -1;
-    if (TEMP_FAILURE_RETRY(lstat(path, &sb)) == -1) {
+    if (TEMP_FAILURE_RETRY(fstatat(dir_fd, name, &sb, AT_SYMLINK_NOFOLLOW)) == -1) {
         if (errno == ENOENT) {
             goto create;
         } else {
@@ -85,8 +89,9 @@ static int fs_prepare_path_impl(const char* path, mode_t mode, uid_t uid, gid_t
 
 create:
     create_result = prepare_as_dir
-        ? TEMP_FAILURE_RETRY(mkdir(path, mode))
-        : TEMP_FAILURE_RETRY(open(path, O_CREAT | O_CLOEXEC | O_NOFOLLOW | O_RDONLY, 0644));
+        ? TEMP_FAILURE_RETRY(mkdirat(dir_fd, name, mode))
+        : TEMP_FAILURE_RETRY(openat(dir_fd, name, O_CREAT | O_CLOEXEC | O_NOFOLLOW | O_RDONLY,
+                                    0644));
     if (create_result == -1) {
         if (errno != EEXIST) {
             ALOGE("Failed to %s(%s): %s",
@@ -100,11 +105,11 @@ create:
         }
     }
 fixup:
-    if (TEMP_FAILURE_RETRY(chmod(path, mode)) == -1) {
+    if (TEMP_FAILURE_RETRY(fchmodat(dir_fd, name, mode, 0)) == -1) {
         ALOGE("Failed to chmod(%s, %d): %s", path, mode, strerror(errno));
         return -1;
     }
-    if (TEMP_FAILURE_RETRY(chown(path, uid, gid)) == -1) {
+    if (TEMP_FAILURE_RETRY(fchownat(dir_fd, name, uid, gid, AT_SYMLINK_NOFOLLOW)) == -1) {
         ALOGE("Failed to chown(%s, %d, %d): %s", path, uid, gid, strerror(errno));
         return -1;
     }
@@ -113,15 +118,118 @@ fixup:
 }
 
 int fs_prepare_dir(const char* path, mode_t mode, uid_t uid, gid_t gid) {
-    return fs_prepare_path_impl(path, mode, uid, gid, /*allow_fixup*/ 1, /*prepare_as_dir*/ 1);
+    return fs_prepare_path_impl(AT_FDCWD, path, path, mode, uid, gid, /*allow_fixup*/ 1,
+            /*prepare_as_dir*/ 1);
 }
 
 int fs_prepare_dir_strict(const char* path, mode_t mode, uid_t uid, gid_t gid) {
-    return fs_prepare_path_impl(path, mode, uid, gid, /*allow_fixup*/ 0, /*prepare_as_dir*/ 1);
+    return fs_prepare_path_impl(AT_FDCWD, path, path, mode, uid, gid, /*allow_fixup*/ 0,
+            /*prepare_as_dir*/ 1);
 }
 
 int fs_prepare_file_strict(const char* path, mode_t mode, uid_t uid, gid_t gid) {
-    return fs_prepare_path_impl(path, mode, uid, gid, /*allow_fixup*/ 0, /*prepare_as_dir*/ 0);
+    return fs_prepare_path_impl(AT_FDCWD, path, path, mode, uid, gid, /*allow_fixup*/ 0,
+            /*prepare_as_dir*/ 0);
+}
+
+// Splits path into its parent, without repeated or trailing slashes, and its
+// last component. The parent is empty for a relative path with a single
+// component, and for "/" the name is the whole path.
+static void split_path(const char* path, std::string* parent, std::string* name) {
+    parent->clear();
+    name->clear();
+    if (*path == '/') *parent = "/";
+    for (const char* p = path; *p != '\0';) {
+        const char* end = p + strcspn(p, "/");
+        if (end != p) {
+            if (!name->empty()) {
+                if (parent->size() > 1) *parent += '/';
+                *parent += *name;
+            }
+            name->assign(p, end - p);
+        }
+        p = (*end == '/') ? end + 1 : end;
+    }
+    if (name->empty()) {
+        parent->clear();
+        *name = path;
+    }
+}
+
+namespace {
+
+// The open ancestors of the last directory fs_prepare_dirs() looked at,
+// outermost first.
+class ParentChain {
+  public:
+    ~ParentChain() {
+        for (const Dir& dir : dirs_) close(dir.fd);
+    }
+
+    // Returns an fd for the directory parent, opening it relative to the
+    // nearest open ancestor if needed, or -1 with errno set.
+    int Open(const std::string& parent) {
+        if (parent.empty()) return AT_FDCWD;
+        while (!dirs_.empty() && !IsAncestor(dirs_.back().path, parent)) {
+            close(dirs_.back().fd);
+            dirs_.pop_back();
+        }
+        if (!dirs_.empty() && dirs_.back().path == parent) return dirs_.back().fd;
+
+        int base = AT_FDCWD;
+        const char* rest = parent.c_str();
+        if (!dirs_.empty()) {
+            const std::string& ancestor = dirs_.back().path;
+            base = dirs_.back().fd;
+            rest += ancestor.size() + (ancestor == "/" ? 0 : 1);
+        }
+        int fd = TEMP_FAILURE_RETRY(openat(base, rest, O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+        if (fd == -1) return -1;
+        dirs_.push_back({ parent, fd });
+        return fd;
+    }
+
+  private:
+    struct Dir {
+        std::string path;
+        int fd;
+    };
+
+    static bool IsAncestor(const std::string& dir, const std::string& path) {
+        return path.compare(0, dir.size(), dir) == 0 &&
+               (path.size() == dir.size() || dir == "/" || path[dir.size()] == '/');
+    }
+
+    std::vector<Dir> dirs_;
+};
+
+}  // namespace
+
+static int fs_prepare_dirs_impl(const struct fs_dir_spec* dirs, size_t count, int allow_fixup) {
+    ParentChain chain;
+    std::string parent, name;
+    for (size_t i = 0; i < count; i++) {
+        const fs_dir_spec& dir = dirs[i];
+        split_path(dir.path, &parent, &name);
+        int dir_fd = chain.Open(parent);
+        if (dir_fd == -1) {
+            ALOGE("Failed to open parent of %s: %s", dir.path, strerror(errno));
+            return -1;
+        }
+        if (fs_prepare_path_impl(dir_fd, name.c_str(), dir.path, dir.mode, dir.uid, dir.gid,
+                allow_fixup, /*prepare_as_dir*/ 1) == -1) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int fs_prepare_dirs(const struct fs_dir_spec* dirs, size_t count) {
+    return fs_prepare_dirs_impl(dirs, count, /*allow_fixup*/ 1);
+}
+
+int fs_prepare_dirs_strict(const struct fs_dir_spec* dirs, size_t count) {
+    return fs_prepare_dirs_impl(dirs, count, /*allow_fixup*/ 0);
 }
 
 int fs_read_atomic_int(const char* path, int* out_value) {
@@ -150,45 +258,229 @@ fail:
 }
 
 int fs_write_atomic_int(const char* path, int value) {
-    char temp[PATH_MAX];
-    if (snprintf(temp, PATH_MAX, "%s.XXXXXX", path) >= PATH_MAX) {
-        ALOGE("Path too long");
+    char buf[BUF_SIZE];
+    int len = snprintf(buf, BUF_SIZE, "%d", value) + 1;
+    if (len > BUF_SIZE) {
+        ALOGE("Value %d too large: %s", value, strerror(errno));
+        return -1;
+    }
+    return fs_write_atomic(path, buf, len, 0600, 0);
+}
+
+// Length of the suffix next_temp_name() appends.
+#define TEMP_SUFFIX_LEN 7
+// How many names to try before giving up, as mkstemp() does.
+#define TEMP_ATTEMPTS 100
+
+static void next_temp_name(const char* name, std::string* temp) {
+    static uint32_t counter;
+    uint32_t n = static_cast<uint32_t>(getpid()) * 0x9e3779b1u +
+                 __atomic_fetch_add(&counter, 1, __ATOMIC_RELAXED);
+    char suffix[TEMP_SUFFIX_LEN + 1];
+    snprintf(suffix, sizeof(suffix), ".%06x", n & 0xffffff);
+    *temp = name;
+    *temp += suffix;
+}
+
+static int fill_temp(int fd, const fs_atomic_file& file, mode_t mode, int flags) {
+    const char* p = static_cast<const char*>(file.data);
+    size_t left = file.len;
+    while (left > 0) {
+        ssize_t n = TEMP_FAILURE_RETRY(write(fd, p, left));
+        if (n <= 0) {
+            if (n == 0) errno = EIO;
+            ALOGE("Failed to write %s: %s", file.name, strerror(errno));
+            return -1;
+        }
+        p += n;
+        left -= n;
+    }
+    // Neither mkstemp()'s nor the umask's idea of the mode is what was asked for.
+    if (TEMP_FAILURE_RETRY(fchmod(fd, mode)) == -1) {
+        ALOGE("Failed to chmod %s: %s", file.name, strerror(errno));
         return -1;
     }
+    if (flags & FS_WRITE_ATOMIC_FSYNC) {
+#if defined(__APPLE__)
+        int res = TEMP_FAILURE_RETRY(fsync(fd));
+#else
+        int res = TEMP_FAILURE_RETRY(fdatasync(fd));
+#endif
+        if (res == -1) {
+            ALOGE("Failed to sync %s: %s", file.name, strerror(errno));
+            return -1;
+        }
+    }
+    return 0;
+}
+
+#if defined(O_TMPFILE)
 
-    int fd = TEMP_FAILURE_RETRY(mkstemp(temp));
+// Writes the file without a name and links it in under a temporary one once
+// it is complete. Returns 1 if the filesystem or the environment doesn't
+// allow that, so the caller can fall back to a named temporary file.
+static int write_tmpfile(int dir_fd, const fs_atomic_file& file, mode_t mode, int flags,
+                         std::string* temp) {
+    int fd = TEMP_FAILURE_RETRY(openat(dir_fd, ".", O_TMPFILE | O_WRONLY | O_CLOEXEC, mode));
     if (fd == -1) {
-        ALOGE("Failed to open %s: %s", temp, strerror(errno));
+        if (errno == EOPNOTSUPP || errno == EISDIR || errno == EINVAL) return 1;
+        ALOGE("Failed to create temporary file for %s: %s", file.name, strerror(errno));
+        return -1;
+    }
+    if (fill_temp(fd, file, mode, flags) == -1) {
+        close(fd);
         return -1;
     }
 
-    char buf[BUF_SIZE];
-    int len = snprintf(buf, BUF_SIZE, "%d", value) + 1;
-    if (len > BUF_SIZE) {
-        ALOGE("Value %d too large: %s", value, strerror(errno));
-        goto fail;
+    // Linking by fd needs CAP_DAC_READ_SEARCH; the /proc path doesn't.
+    char proc_path[32];
+    snprintf(proc_path, sizeof(proc_path), "/proc/self/fd/%d", fd);
+    int res = -1;
+    for (int attempt = 0; attempt < TEMP_ATTEMPTS; attempt++) {
+        next_temp_name(file.name, temp);
+        res = linkat(AT_FDCWD, proc_path, dir_fd, temp->c_str(), AT_SYMLINK_FOLLOW);
+        if (res == -1 && errno == ENOENT) {
+            res = linkat(fd, "", dir_fd, temp->c_str(), AT_EMPTY_PATH);
+        }
+        if (res == 0 || errno != EEXIST) break;
     }
-    if (TEMP_FAILURE_RETRY(write(fd, buf, len)) < len) {
-        ALOGE("Failed to write %s: %s", temp, strerror(errno));
-        goto fail;
+    int saved_errno = errno;
+    close(fd);
+    if (res == -1) {
+        if (saved_errno == ENOENT || saved_errno == EPERM) return 1;
+        ALOGE("Failed to link %s: %s", temp->c_str(), strerror(saved_errno));
+        errno = saved_errno;
+        return -1;
     }
-    if (close(fd) == -1) {
-        ALOGE("Failed to close %s: %s", temp, strerror(errno));
-        goto fail_closed;
+    return 0;
+}
+
+#endif
+
+// Writes the file's new contents to a temporary file in dir_fd, whose name
+// is returned in temp. Once this returns 0, the file only needs renaming.
+static int write_temp(int dir_fd, const fs_atomic_file& file, mode_t mode, int flags,
+                      bool* try_tmpfile, std::string* temp) {
+#if defined(O_TMPFILE)
+    if (*try_tmpfile) {
+        int res = write_tmpfile(dir_fd, file, mode, flags, temp);
+        if (res <= 0) return res;
+        // Don't try again for the rest of the batch.
+        *try_tmpfile = false;
     }
+#else
+    (void)try_tmpfile;
+#endif
 
-    if (rename(temp, path) == -1) {
-        ALOGE("Failed to rename %s to %s: %s", temp, path, strerror(errno));
-        goto fail_closed;
+    int fd = -1;
+    for (int attempt = 0; attempt < TEMP_ATTEMPTS && fd == -1; attempt++) {
+        next_temp_name(file.name, temp);
+        fd = TEMP_FAILURE_RETRY(openat(dir_fd, temp->c_str(),
+                O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC | O_NOFOLLOW, mode));
+        if (fd == -1 && errno != EEXIST) break;
+    }
+    if (fd == -1) {
+        ALOGE("Failed to open %s: %s", temp->c_str(), strerror(errno));
+        return -1;
+    }
+    int res = fill_temp(fd, file, mode, flags);
+    int saved_errno = errno;
+    if (close(fd) == -1 && res == 0) {
+        ALOGE("Failed to close %s: %s", temp->c_str(), strerror(errno));
+        saved_errno = errno;
+        res = -1;
     }
+    if (res == -1) {
+        unlinkat(dir_fd, temp->c_str(), 0);
+        errno = saved_errno;
+    }
+    return res;
+}
 
-    return 0;
+int fs_write_atomic_batch(const char* dir, const struct fs_atomic_file* files, size_t count,
+        mode_t mode, int flags) {
+    for (size_t i = 0; i < count; i++) {
+        const char* name = files[i].name;
+        if (*name == '\0' || strchr(name, '/') != nullptr || !strcmp(name, ".") ||
+                !strcmp(name, "..")) {
+            ALOGE("Invalid file name: %s", name);
+            errno = EINVAL;
+            return -1;
+        }
+        if (strlen(name) + TEMP_SUFFIX_LEN > NAME_MAX) {
+            ALOGE("File name too long: %s", name);
+            errno = ENAMETOOLONG;
+            return -1;
+        }
+    }
 
-fail:
-    close(fd);
-fail_closed:
-    unlink(temp);
-    return -1;
+    int dir_fd = TEMP_FAILURE_RETRY(open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+    if (dir_fd == -1) {
+        ALOGE("Failed to open %s: %s", dir, strerror(errno));
+        return -1;
+    }
+
+    // Write everything before replacing anything, so that a failure part way
+    // through the writes leaves every file as it was.
+    std::vector<std::string> temps(count);
+    bool try_tmpfile = true;
+    size_t written = 0;
+    int res = 0;
+    for (; written < count; written++) {
+        if (write_temp(dir_fd, files[written], mode, flags, &try_tmpfile,
+                       &temps[written]) == -1) {
+            res = -1;
+            break;
+        }
+    }
+
+    size_t renamed = 0;
+    if (res == 0) {
+        for (; renamed < count; renamed++) {
+            if (renameat(dir_fd, temps[renamed].c_str(), dir_fd, files[renamed].name) == -1) {
+                ALOGE("Failed to rename %s to %s: %s", temps[renamed].c_str(),
+                        files[renamed].name, strerror(errno));
+                res = -1;
+                break;
+            }
+        }
+    }
+
+    int saved_errno = errno;
+    for (size_t i = renamed; i < written; i++) {
+        unlinkat(dir_fd, temps[i].c_str(), 0);
+    }
+    if (res == 0 && (flags & FS_WRITE_ATOMIC_FSYNC_DIR) &&
+            TEMP_FAILURE_RETRY(fsync(dir_fd)) == -1) {
+        ALOGE("Failed to sync %s: %s", dir, strerror(errno));
+        saved_errno = errno;
+        res = -1;
+    }
+    close(dir_fd);
+    errno = saved_errno;
+    return res;
+}
+
+int fs_write_atomic(const char* path, const void* data, size_t len, mode_t mode, int flags) {
+    char dir[PATH_MAX];
+    const char* name = strrchr(path, '/');
+    if (name == nullptr) {
+        strcpy(dir, ".");
+        name = path;
+    } else {
+        size_t dir_len = (name == path) ? 1 : name - path;
+        if (dir_len >= PATH_MAX) {
+            ALOGE("Path too long");
+            errno = ENAMETOOLONG;
+            return -1;
+        }
+        memcpy(dir, path, dir_len);
+        dir[dir_len] = '\0';
+        name++;
+    }
+
+    fs_atomic_file file = { name, data, len };
+    return fs_write_atomic_batch(dir, &file, 1, mode, flags);
 }
 
 #ifndef __APPLE__
@@ -220,41 +512,37 @@ int fs_mkdirs(const char* path, mode_t mode) {
                 goto done_close;
             }
 
-            if (fstatat(fd, segment, &sb, AT_SYMLINK_NOFOLLOW) != 0) {
-                if (errno == ENOENT) {
-                    /* Nothing there yet; let's create it! */
-                    if (mkdirat(fd, segment, mode) != 0) {
-                        if (errno == EEXIST) {
-                            /* We raced with someone; ignore */
-                        } else {
-                            ALOGE("Failed to mkdirat(%s): %s", buf, strerror(errno));
-                            res = -errno;
-                            goto done_close;
-                        }
+            /* Most segments already exist, so try to step into them first */
+            int next_fd = TEMP_FAILURE_RETRY(openat(fd, segment,
+                    O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC));
+            if (next_fd == -1 && errno == ENOENT) {
+                /* Nothing there yet; let's create it! */
+                if (mkdirat(fd, segment, mode) != 0) {
+                    if (errno == EEXIST) {
+                        /* We raced with someone; ignore */
+                    } else {
+                        ALOGE("Failed to mkdirat(%s): %s", buf, strerror(errno));
+                        res = -errno;
+                        goto done_close;
+                    }
+                }
+                next_fd = TEMP_FAILURE_RETRY(openat(fd, segment,
+                        O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC));
+            }
+            if (next_fd == -1) {
+                /* O_NOFOLLOW | O_DIRECTORY fails symlinks with ENOTDIR too */
+                if (errno == ENOTDIR && fstatat(fd, segment, &sb, AT_SYMLINK_NOFOLLOW) == 0) {
+                    if (S_ISLNK(sb.st_mode)) {
+                        ALOGE("Symbolic links are not allowed: %s", buf);
+                        res = -ELOOP;
+                    } else {
+                        ALOGE("Existing segment not a directory: %s", buf);
+                        res = -ENOTDIR;
                     }
                 } else {
-                    ALOGE("Failed to fstatat(%s): %s", buf, strerror(errno));
+                    ALOGE("Failed to openat(%s): %s", buf, strerror(errno));
                     res = -errno;
-                    goto done_close;
-                }
-            } else {
-                if (S_ISLNK(sb.st_mode)) {
-                    ALOGE("Symbolic links are not allowed: %s", buf);
-                    res = -ELOOP;
-                    goto done_close;
                 }
-                if (!S_ISDIR(sb.st_mode)) {
-                    ALOGE("Existing segment not a directory: %s", buf);
-                    res = -ENOTDIR;
-                    goto done_close;
-                }
-            }
-
-            /* Yay, segment is ready for us to step into */
-            int next_fd;
-            if ((next_fd = openat(fd, segment, O_NOFOLLOW | O_CLOEXEC)) == -1) {
-                ALOGE("Failed to openat(%s): %s", buf, strerror(errno));
-                res = -errno;
                 goto done_close;
             }
 
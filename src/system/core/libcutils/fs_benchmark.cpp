@@ -0,0 +1,195 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <cutils/fs.h>
+
+#include <ftw.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include <android-base/file.h>
+#include <android-base/logging.h>
+#include <android-base/stringprintf.h>
+#include <benchmark/benchmark.h>
+
+using android::base::StringPrintf;
+
+// A service persisting state.range(0) small counters, one file each.
+
+static void BM_fs_write_atomic_int(benchmark::State& state) {
+    TemporaryDir td;
+    std::vector<std::string> paths;
+    for (int i = 0; i < state.range(0); i++) {
+        paths.push_back(StringPrintf("%s/counter%d", td.path, i));
+    }
+    int value = 0;
+    while (state.KeepRunning()) {
+        for (const std::string& path : paths) {
+            CHECK_EQ(0, fs_write_atomic_int(path.c_str(), value++));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * paths.size());
+}
+BENCHMARK(BM_fs_write_atomic_int)->Arg(1)->Arg(16);
+
+static void BM_fs_write_atomic(benchmark::State& state, int flags) {
+    TemporaryDir td;
+    std::vector<std::string> paths;
+    for (int i = 0; i < state.range(0); i++) {
+        paths.push_back(StringPrintf("%s/counter%d", td.path, i));
+    }
+    int value = 0;
+    while (state.KeepRunning()) {
+        for (const std::string& path : paths) {
+            std::string contents = std::to_string(value++);
+            CHECK_EQ(0, fs_write_atomic(path.c_str(), contents.data(), contents.size(), 0600,
+                                        flags));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * paths.size());
+}
+BENCHMARK_CAPTURE(BM_fs_write_atomic, nosync, 0)->Arg(1)->Arg(16);
+BENCHMARK_CAPTURE(BM_fs_write_atomic, durable, FS_WRITE_ATOMIC_DURABLE)->Arg(1)->Arg(16);
+
+static void BM_fs_write_atomic_batch(benchmark::State& state, int flags) {
+    TemporaryDir td;
+    std::vector<std::string> names;
+    for (int i = 0; i < state.range(0); i++) {
+        names.push_back(StringPrintf("counter%d", i));
+    }
+    std::vector<std::string> contents(names.size());
+    std::vector<fs_atomic_file> files(names.size());
+    int value = 0;
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < names.size(); i++) {
+            contents[i] = std::to_string(value++);
+            files[i] = { names[i].c_str(), contents[i].data(), contents[i].size() };
+        }
+        CHECK_EQ(0, fs_write_atomic_batch(td.path, files.data(), files.size(), 0600, flags));
+    }
+    state.SetItemsProcessed(state.iterations() * names.size());
+}
+BENCHMARK_CAPTURE(BM_fs_write_atomic_batch, nosync, 0)->Arg(1)->Arg(16);
+BENCHMARK_CAPTURE(BM_fs_write_atomic_batch, durable, FS_WRITE_ATOMIC_DURABLE)->Arg(1)->Arg(16);
+
+// First-boot style setup of 10K directories: 10 users, 10 apps each and
+// 100 data directories per app, below a few levels of existing prefix.
+
+static std::vector<std::string> DirTree(const std::string& base) {
+    std::vector<std::string> paths;
+    for (int user = 0; user < 10; user++) {
+        std::string user_dir = StringPrintf("%s/user%d", base.c_str(), user);
+        paths.push_back(user_dir);
+        for (int app = 0; app < 10; app++) {
+            std::string app_dir = StringPrintf("%s/com.example.app%d", user_dir.c_str(), app);
+            paths.push_back(app_dir);
+            for (int dir = 0; dir < 100; dir++) {
+                paths.push_back(StringPrintf("%s/dir%d", app_dir.c_str(), dir));
+            }
+        }
+    }
+    return paths;
+}
+
+static void RemoveTree(const std::string& path) {
+    nftw(path.c_str(), [](const char* p, const struct stat*, int, FTW*) { return remove(p); },
+         64, FTW_DEPTH | FTW_PHYS);
+}
+
+static void BM_fs_prepare_dir_tree(benchmark::State& state, bool batch) {
+    TemporaryDir td;
+    std::string base = StringPrintf("%s/data/misc/profiles/cur", td.path);
+    CHECK_EQ(0, fs_mkdirs((base + "/").c_str(), 0700));
+    std::vector<std::string> paths = DirTree(base);
+    std::vector<fs_dir_spec> dirs;
+    for (const std::string& path : paths) {
+        dirs.push_back({ path.c_str(), 0751, getuid(), getgid() });
+    }
+
+    while (state.KeepRunning()) {
+        if (batch) {
+            CHECK_EQ(0, fs_prepare_dirs(dirs.data(), dirs.size()));
+        } else {
+            for (const fs_dir_spec& dir : dirs) {
+                CHECK_EQ(0, fs_prepare_dir(dir.path, dir.mode, dir.uid, dir.gid));
+            }
+        }
+        state.PauseTiming();
+        for (int user = 0; user < 10; user++) {
+            RemoveTree(StringPrintf("%s/user%d", base.c_str(), user));
+        }
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * dirs.size());
+}
+BENCHMARK_CAPTURE(BM_fs_prepare_dir_tree, one_by_one, false)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_fs_prepare_dir_tree, batch, true)->Unit(benchmark::kMillisecond);
+
+// The same tree once it exists, as on every boot after the first.
+static void BM_fs_prepare_dir_tree_existing(benchmark::State& state, bool batch) {
+    TemporaryDir td;
+    std::string base = StringPrintf("%s/data/misc/profiles/cur", td.path);
+    CHECK_EQ(0, fs_mkdirs((base + "/").c_str(), 0700));
+    std::vector<std::string> paths = DirTree(base);
+    std::vector<fs_dir_spec> dirs;
+    for (const std::string& path : paths) {
+        dirs.push_back({ path.c_str(), 0751, getuid(), getgid() });
+    }
+    CHECK_EQ(0, fs_prepare_dirs(dirs.data(), dirs.size()));
+
+    while (state.KeepRunning()) {
+        if (batch) {
+            CHECK_EQ(0, fs_prepare_dirs(dirs.data(), dirs.size()));
+        } else {
+            for (const fs_dir_spec& dir : dirs) {
+                CHECK_EQ(0, fs_prepare_dir(dir.path, dir.mode, dir.uid, dir.gid));
+            }
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * dirs.size());
+}
+BENCHMARK_CAPTURE(BM_fs_prepare_dir_tree_existing, one_by_one, false)
+        ->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_fs_prepare_dir_tree_existing, batch, true)->Unit(benchmark::kMillisecond);
+
+#if !defined(__APPLE__)
+static void BM_fs_mkdirs_tree(benchmark::State& state) {
+    TemporaryDir td;
+    std::string base = StringPrintf("%s/data/misc/profiles/cur", td.path);
+    CHECK_EQ(0, fs_mkdirs((base + "/").c_str(), 0700));
+    std::vector<std::string> paths = DirTree(base);
+    for (std::string& path : paths) path += '/';
+
+    while (state.KeepRunning()) {
+        for (const std::string& path : paths) {
+            CHECK_EQ(0, fs_mkdirs(path.c_str(), 0751));
+        }
+        state.PauseTiming();
+        for (int user = 0; user < 10; user++) {
+            RemoveTree(StringPrintf("%s/user%d", base.c_str(), user));
+        }
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * paths.size());
+}
+BENCHMARK(BM_fs_mkdirs_tree)->Unit(benchmark::kMillisecond);
+#endif
+
+BENCHMARK_MAIN();
@@ -0,0 +1,281 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <cutils/fs.h>
+
+#include <dirent.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <set>
+#include <string>
+
+#include <android-base/file.h>
+#include <android-base/stringprintf.h>
+#include <gtest/gtest.h>
+
+using android::base::ReadFileToString;
+using android::base::StringPrintf;
+
+static std::set<std::string> ListDir(const char* path) {
+    std::set<std::string> names;
+    DIR* dir = opendir(path);
+    if (dir == nullptr) return names;
+    while (dirent* entry = readdir(dir)) {
+        if (strcmp(entry->d_name, ".") && strcmp(entry->d_name, "..")) {
+            names.insert(entry->d_name);
+        }
+    }
+    closedir(dir);
+    return names;
+}
+
+TEST(FsTest, write_atomic) {
+    TemporaryDir td;
+    std::string path = StringPrintf("%s/file", td.path);
+    for (int flags : { 0, FS_WRITE_ATOMIC_FSYNC, FS_WRITE_ATOMIC_DURABLE }) {
+        std::string contents = StringPrintf("contents %d", flags);
+        ASSERT_EQ(0, fs_write_atomic(path.c_str(), contents.data(), contents.size(), 0640,
+                                     flags));
+        std::string actual;
+        ASSERT_TRUE(ReadFileToString(path, &actual));
+        EXPECT_EQ(contents, actual);
+    }
+
+    // The mode is exactly what was asked for, whatever the umask.
+    struct stat sb;
+    ASSERT_EQ(0, stat(path.c_str(), &sb));
+    EXPECT_EQ(0640u, sb.st_mode & 0777);
+    EXPECT_EQ(std::set<std::string>({ "file" }), ListDir(td.path));
+}
+
+TEST(FsTest, write_atomic_empty) {
+    TemporaryDir td;
+    std::string path = StringPrintf("%s/file", td.path);
+    ASSERT_TRUE(android::base::WriteStringToFile("old", path));
+    ASSERT_EQ(0, fs_write_atomic(path.c_str(), "", 0, 0600, 0));
+    std::string actual;
+    ASSERT_TRUE(ReadFileToString(path, &actual));
+    EXPECT_EQ("", actual);
+}
+
+TEST(FsTest, write_atomic_int) {
+    TemporaryDir td;
+    std::string path = StringPrintf("%s/counter", td.path);
+    int value;
+    ASSERT_EQ(0, fs_write_atomic_int(path.c_str(), 42));
+    ASSERT_EQ(0, fs_read_atomic_int(path.c_str(), &value));
+    EXPECT_EQ(42, value);
+    ASSERT_EQ(0, fs_write_atomic_int(path.c_str(), -7));
+    ASSERT_EQ(0, fs_read_atomic_int(path.c_str(), &value));
+    EXPECT_EQ(-7, value);
+    EXPECT_EQ(std::set<std::string>({ "counter" }), ListDir(td.path));
+}
+
+TEST(FsTest, write_atomic_batch) {
+    TemporaryDir td;
+    std::string a = "first", b = "second", c(100000, 'c');
+    fs_atomic_file files[] = {
+        { "a", a.data(), a.size() },
+        { "b", b.data(), b.size() },
+        { "c", c.data(), c.size() },
+    };
+    ASSERT_EQ(0, fs_write_atomic_batch(td.path, files, 3, 0600, FS_WRITE_ATOMIC_DURABLE));
+    EXPECT_EQ(std::set<std::string>({ "a", "b", "c" }), ListDir(td.path));
+
+    std::string actual;
+    ASSERT_TRUE(ReadFileToString(StringPrintf("%s/a", td.path), &actual));
+    EXPECT_EQ(a, actual);
+    ASSERT_TRUE(ReadFileToString(StringPrintf("%s/b", td.path), &actual));
+    EXPECT_EQ(b, actual);
+    ASSERT_TRUE(ReadFileToString(StringPrintf("%s/c", td.path), &actual));
+    EXPECT_EQ(c, actual);
+
+    ASSERT_EQ(0, fs_write_atomic_batch(td.path, files, 0, 0600, FS_WRITE_ATOMIC_DURABLE));
+}
+
+TEST(FsTest, write_atomic_batch_invalid) {
+    TemporaryDir td;
+    std::string path = StringPrintf("%s/a", td.path);
+    ASSERT_TRUE(android::base::WriteStringToFile("old", path));
+
+    // Nothing is replaced if any entry is bad.
+    for (const char* bad : { "", ".", "..", "x/y" }) {
+        fs_atomic_file files[] = {
+            { "a", "new", 3 },
+            { bad, "new", 3 },
+        };
+        errno = 0;
+        EXPECT_EQ(-1, fs_write_atomic_batch(td.path, files, 2, 0600, 0)) << bad;
+        EXPECT_EQ(EINVAL, errno) << bad;
+    }
+    std::string long_name(NAME_MAX, 'x');
+    fs_atomic_file files[] = { { long_name.c_str(), "new", 3 } };
+    EXPECT_EQ(-1, fs_write_atomic_batch(td.path, files, 1, 0600, 0));
+    EXPECT_EQ(ENAMETOOLONG, errno);
+
+    std::string actual;
+    ASSERT_TRUE(ReadFileToString(path, &actual));
+    EXPECT_EQ("old", actual);
+    EXPECT_EQ(std::set<std::string>({ "a" }), ListDir(td.path));
+
+    std::string missing = StringPrintf("%s/missing", td.path);
+    fs_atomic_file file = { "a", "new", 3 };
+    EXPECT_EQ(-1, fs_write_atomic_batch(missing.c_str(), &file, 1, 0600, 0));
+    EXPECT_EQ(ENOENT, errno);
+}
+
+TEST(FsTest, write_atomic_killed) {
+    // Kill a writer at arbitrary points: every file must still hold one
+    // complete generation, never a mix or a truncated one.
+    constexpr size_t kSize = 256 * 1024;
+    TemporaryDir td;
+    for (int round = 0; round < 10; round++) {
+        pid_t pid = fork();
+        ASSERT_NE(-1, pid);
+        if (pid == 0) {
+            std::string contents(kSize, 'a');
+            for (int generation = 0;; generation++) {
+                std::fill(contents.begin(), contents.end(), 'a' + generation % 26);
+                fs_atomic_file files[] = {
+                    { "x", contents.data(), contents.size() },
+                    { "y", contents.data(), contents.size() },
+                };
+                fs_write_atomic_batch(td.path, files, 2, 0600, 0);
+            }
+        }
+        usleep(1000 + round * 2000);
+        kill(pid, SIGKILL);
+        ASSERT_EQ(pid, TEMP_FAILURE_RETRY(waitpid(pid, nullptr, 0)));
+
+        for (const char* name : { "x", "y" }) {
+            std::string actual;
+            if (!ReadFileToString(StringPrintf("%s/%s", td.path, name), &actual)) continue;
+            ASSERT_EQ(kSize, actual.size()) << name;
+            ASSERT_EQ(std::string(kSize, actual[0]), actual) << name;
+        }
+    }
+}
+
+static mode_t ModeOf(const std::string& path) {
+    struct stat sb;
+    if (lstat(path.c_str(), &sb) == -1) return 0;
+    return sb.st_mode & 07777;
+}
+
+TEST(FsTest, prepare_dirs) {
+    TemporaryDir td;
+    std::string base = td.path;
+    std::string a = base + "/a", b = base + "//a/b/", c = base + "/a/c", d = base + "/a/b/d";
+    std::string e = base + "/e";
+    uid_t uid = getuid();
+    gid_t gid = getgid();
+    fs_dir_spec dirs[] = {
+        { a.c_str(), 0750, uid, gid },
+        { b.c_str(), 0700, uid, gid },
+        { c.c_str(), 0711, uid, gid },
+        { d.c_str(), 0755, uid, gid },
+        { e.c_str(), 0770, uid, gid },
+    };
+    ASSERT_EQ(0, fs_prepare_dirs(dirs, 5));
+    EXPECT_EQ(0750u, ModeOf(a));
+    EXPECT_EQ(0700u, ModeOf(base + "/a/b"));
+    EXPECT_EQ(0711u, ModeOf(c));
+    EXPECT_EQ(0755u, ModeOf(d));
+    EXPECT_EQ(0770u, ModeOf(e));
+
+    // Existing directories are fixed up, and the result is the same as
+    // preparing each one by itself.
+    ASSERT_EQ(0, chmod(c.c_str(), 0777));
+    ASSERT_EQ(0, fs_prepare_dirs(dirs, 5));
+    EXPECT_EQ(0711u, ModeOf(c));
+    ASSERT_EQ(0, chmod(c.c_str(), 0777));
+    ASSERT_EQ(0, fs_prepare_dir(c.c_str(), 0711, uid, gid));
+    EXPECT_EQ(0711u, ModeOf(c));
+
+    // The strict variant leaves a mismatched mode alone.
+    ASSERT_EQ(0, chmod(c.c_str(), 0777));
+    ASSERT_EQ(0, fs_prepare_dirs_strict(dirs, 5));
+    EXPECT_EQ(0777u, ModeOf(c));
+}
+
+TEST(FsTest, prepare_dirs_relative) {
+    TemporaryDir td;
+    char old_cwd[PATH_MAX];
+    ASSERT_NE(nullptr, getcwd(old_cwd, sizeof(old_cwd)));
+    ASSERT_EQ(0, chdir(td.path));
+    fs_dir_spec dirs[] = {
+        { "x", 0700, getuid(), getgid() },
+        { "x/y", 0700, getuid(), getgid() },
+        { "z", 0700, getuid(), getgid() },
+    };
+    int res = fs_prepare_dirs(dirs, 3);
+    ASSERT_EQ(0, chdir(old_cwd));
+    ASSERT_EQ(0, res);
+    EXPECT_EQ(0700u, ModeOf(StringPrintf("%s/x/y", td.path)));
+    EXPECT_EQ(0700u, ModeOf(StringPrintf("%s/z", td.path)));
+}
+
+TEST(FsTest, prepare_dirs_errors) {
+    TemporaryDir td;
+    std::string missing = StringPrintf("%s/missing/a", td.path);
+    std::string file = StringPrintf("%s/file", td.path);
+    std::string link = StringPrintf("%s/link", td.path);
+    ASSERT_TRUE(android::base::WriteStringToFile("", file));
+    ASSERT_EQ(0, symlink(td.path, link.c_str()));
+
+    fs_dir_spec dir = { missing.c_str(), 0700, getuid(), getgid() };
+    EXPECT_EQ(-1, fs_prepare_dirs(&dir, 1));
+    EXPECT_EQ(ENOENT, errno);
+    dir.path = file.c_str();
+    EXPECT_EQ(-1, fs_prepare_dirs(&dir, 1));
+    dir.path = link.c_str();
+    EXPECT_EQ(-1, fs_prepare_dirs(&dir, 1));
+
+    // Owners are never fixed by the strict variant.
+    dir.path = td.path;
+    dir.uid = getuid() + 1;
+    EXPECT_EQ(-1, fs_prepare_dirs_strict(&dir, 1));
+}
+
+#if !defined(__APPLE__)
+TEST(FsTest, mkdirs) {
+    TemporaryDir td;
+    std::string path = StringPrintf("%s/a/b/c/", td.path);
+    ASSERT_EQ(0, fs_mkdirs(path.c_str(), 0700));
+    struct stat sb;
+    ASSERT_EQ(0, stat(path.c_str(), &sb));
+    EXPECT_TRUE(S_ISDIR(sb.st_mode));
+    ASSERT_EQ(0, fs_mkdirs(path.c_str(), 0700));
+
+    // The last segment is a file name unless the path ends with '/'.
+    std::string file = StringPrintf("%s/a/file", td.path);
+    ASSERT_EQ(0, fs_mkdirs(file.c_str(), 0700));
+    EXPECT_EQ(0u, ModeOf(file));
+
+    ASSERT_TRUE(android::base::WriteStringToFile("", file));
+    EXPECT_EQ(-ENOTDIR, fs_mkdirs((file + "/x/").c_str(), 0700));
+    std::string link = StringPrintf("%s/link", td.path);
+    ASSERT_EQ(0, symlink(td.path, link.c_str()));
+    EXPECT_EQ(-ELOOP, fs_mkdirs((link + "/x/").c_str(), 0700));
+    EXPECT_EQ(-EINVAL, fs_mkdirs(StringPrintf("%s/a/../x/", td.path).c_str(), 0700));
+    EXPECT_EQ(-EINVAL, fs_mkdirs("relative/", 0700));
+}
+#endif
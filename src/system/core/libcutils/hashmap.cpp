@@ -23,6 +23,8 @@
 #include <string.h>
 #include <sys/types.h>
 
+#include "hashmap_flat.h"
+
 typedef struct Entry Entry;
 struct Entry {
     void* key;
@@ -38,10 +40,28 @@ struct Hashmap {
     bool (*equals)(void* keyA, void* keyB);
     pthread_mutex_t lock;
     size_t size;
+    // Non-NULL if the map uses the open-addressing engine instead of buckets.
+    FlatHashmap* flat;
+    bool incrementalResize;
+    // Non-NULL while an incremental resize is in progress. Old buckets below
+    // migrated have already been moved into buckets.
+    Entry** oldBuckets;
+    size_t oldBucketCount;
+    size_t migrated;
 };
 
+// Old buckets moved by each hashmapPut() during an incremental resize. The
+// new table is twice as large, so anything above 4/3 finishes the move
+// before the next resize is due.
+#define INCREMENTAL_RESIZE_STEP 4
+
 Hashmap* hashmapCreate(size_t initialCapacity,
         int (*hash)(void* key), bool (*equals)(void* keyA, void* keyB)) {
+    return hashmapCreateWithFlags(initialCapacity, hash, equals, 0);
+}
+
+Hashmap* hashmapCreateWithFlags(size_t initialCapacity,
+        int (*hash)(void* key), bool (*equals)(void* keyA, void* keyB), unsigned flags) {
     assert(hash != NULL);
     assert(equals != NULL);
 
@@ -50,6 +70,29 @@ Hashmap* hashmapCreate(size_t initialCapacity,
         return NULL;
     }
 
+    map->size = 0;
+
+    map->hash = hash;
+    map->equals = equals;
+
+    map->incrementalResize = (flags & HASHMAP_FLAG_INCREMENTAL_RESIZE) != 0;
+    map->oldBuckets = NULL;
+    map->oldBucketCount = 0;
+    map->migrated = 0;
+
+    if (flags & (HASHMAP_FLAG_FLAT | HASHMAP_FLAG_CONCURRENT_READS)) {
+        map->flat = flatHashmapCreate(initialCapacity, flags & HASHMAP_FLAG_CONCURRENT_READS);
+        if (map->flat == NULL) {
+            free(map);
+            return NULL;
+        }
+        map->buckets = NULL;
+        map->bucketCount = 0;
+        pthread_mutex_init(&map->lock, nullptr);
+        return map;
+    }
+    map->flat = NULL;
+
     // 0.75 load factor.
     size_t minimumBucketCount = initialCapacity * 4 / 3;
     map->bucketCount = 1;
@@ -64,11 +107,6 @@ Hashmap* hashmapCreate(size_t initialCapacity,
         return NULL;
     }
 
-    map->size = 0;
-
-    map->hash = hash;
-    map->equals = equals;
-
     pthread_mutex_init(&map->lock, nullptr);
 
     return map;
@@ -97,9 +135,77 @@ static inline size_t calculateIndex(size_t bucketCount, int hash) {
     return ((size_t) hash) & (bucketCount - 1);
 }
 
+/**
+ * Returns the chain that holds, or would hold, an entry with the given hash.
+ * During an incremental resize, that is the old bucket until it is moved.
+ */
+static inline Entry** bucketFor(Hashmap* map, int hash) {
+    if (map->oldBuckets != NULL) {
+        size_t oldIndex = calculateIndex(map->oldBucketCount, hash);
+        if (oldIndex >= map->migrated) {
+            return &map->oldBuckets[oldIndex];
+        }
+    }
+    return &map->buckets[calculateIndex(map->bucketCount, hash)];
+}
+
+/**
+ * Moves up to count old buckets into the new table, and drops the old table
+ * once it is empty.
+ */
+static void migrateBuckets(Hashmap* map, size_t count) {
+    while (count-- > 0 && map->migrated < map->oldBucketCount) {
+        Entry* entry = map->oldBuckets[map->migrated];
+        while (entry != NULL) {
+            Entry* next = entry->next;
+            size_t index = calculateIndex(map->bucketCount, entry->hash);
+            entry->next = map->buckets[index];
+            map->buckets[index] = entry;
+            entry = next;
+        }
+        map->oldBuckets[map->migrated++] = NULL;
+    }
+    if (map->migrated == map->oldBucketCount) {
+        free(map->oldBuckets);
+        map->oldBuckets = NULL;
+        map->oldBucketCount = 0;
+        map->migrated = 0;
+    }
+}
+
+/**
+ * Switches to a table twice as large, leaving the entries where they are
+ * for later puts to move.
+ */
+static void startIncrementalResize(Hashmap* map) {
+    if (map->oldBuckets != NULL) {
+        // Puts move buckets faster than the map can grow, so this is only a
+        // safety net: finish the previous resize first.
+        migrateBuckets(map, map->oldBucketCount);
+    }
+
+    size_t newBucketCount = map->bucketCount << 1;
+    Entry** newBuckets = static_cast<Entry**>(calloc(newBucketCount, sizeof(Entry*)));
+    if (newBuckets == NULL) {
+        // Abort expansion.
+        return;
+    }
+
+    map->oldBuckets = map->buckets;
+    map->oldBucketCount = map->bucketCount;
+    map->migrated = 0;
+    map->buckets = newBuckets;
+    map->bucketCount = newBucketCount;
+}
+
 static void expandIfNecessary(Hashmap* map) {
     // If the load factor exceeds 0.75...
     if (map->size > (map->bucketCount * 3 / 4)) {
+        if (map->incrementalResize) {
+            startIncrementalResize(map);
+            return;
+        }
+
         // Start off with a 0.33 load factor.
         size_t newBucketCount = map->bucketCount << 1;
         Entry** newBuckets = static_cast<Entry**>(calloc(newBucketCount, sizeof(Entry*)));
@@ -137,6 +243,12 @@ void hashmapUnlock(Hashmap* map) {
 }
 
 void hashmapFree(Hashmap* map) {
+    if (map->flat != NULL) {
+        flatHashmapFree(map->flat);
+    }
+    if (map->oldBuckets != NULL) {
+        migrateBuckets(map, map->oldBucketCount);
+    }
     size_t i;
     for (i = 0; i < map->bucketCount; i++) {
         Entry* entry = map->buckets[i];
@@ -191,9 +303,14 @@ static inline bool equalKeys(void* keyA, int hashA, void* keyB, int hashB,
 
 void* hashmapPut(Hashmap* map, void* key, void* value) {
     int hash = hashKey(map, key);
-    size_t index = calculateIndex(map->bucketCount, hash);
+    if (map->flat != NULL) {
+        return flatHashmapPut(map->flat, hash, key, value, map->equals);
+    }
+    if (map->oldBuckets != NULL) {
+        migrateBuckets(map, INCREMENTAL_RESIZE_STEP);
+    }
 
-    Entry** p = &(map->buckets[index]);
+    Entry** p = bucketFor(map, hash);
     while (true) {
         Entry* current = *p;
 
@@ -223,9 +340,11 @@ void* hashmapPut(Hashmap* map, void* key, void* value) {
 
 void* hashmapGet(Hashmap* map, void* key) {
     int hash = hashKey(map, key);
-    size_t index = calculateIndex(map->bucketCount, hash);
+    if (map->flat != NULL) {
+        return flatHashmapGet(map->flat, hash, key, map->equals);
+    }
 
-    Entry* entry = map->buckets[index];
+    Entry* entry = *bucketFor(map, hash);
     while (entry != NULL) {
         if (equalKeys(entry->key, entry->hash, key, hash, map->equals)) {
             return entry->value;
@@ -238,10 +357,12 @@ void* hashmapGet(Hashmap* map, void* key) {
 
 void* hashmapRemove(Hashmap* map, void* key) {
     int hash = hashKey(map, key);
-    size_t index = calculateIndex(map->bucketCount, hash);
+    if (map->flat != NULL) {
+        return flatHashmapRemove(map->flat, hash, key, map->equals);
+    }
 
     // Pointer to the current entry.
-    Entry** p = &(map->buckets[index]);
+    Entry** p = bucketFor(map, hash);
     Entry* current;
     while ((current = *p) != NULL) {
         if (equalKeys(current->key, current->hash, key, hash, map->equals)) {
@@ -260,7 +381,21 @@ void* hashmapRemove(Hashmap* map, void* key) {
 
 void hashmapForEach(Hashmap* map, bool (*callback)(void* key, void* value, void* context),
                     void* context) {
+    if (map->flat != NULL) {
+        flatHashmapForEach(map->flat, callback, context);
+        return;
+    }
     size_t i;
+    for (i = map->migrated; i < map->oldBucketCount; i++) {
+        Entry* entry = map->oldBuckets[i];
+        while (entry != NULL) {
+            Entry *next = entry->next;
+            if (!callback(entry->key, entry->value, context)) {
+                return;
+            }
+            entry = next;
+        }
+    }
     for (i = 0; i < map->bucketCount; i++) {
         Entry* entry = map->buckets[i];
         while (entry != NULL) {
@@ -0,0 +1,185 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cutils/hashmap.h>
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+static int int_hash(void* key) {
+    return static_cast<int>(reinterpret_cast<uintptr_t>(key));
+}
+
+static bool int_equals(void* a, void* b) {
+    return a == b;
+}
+
+static void* K(uintptr_t i) {
+    return reinterpret_cast<void*>(i);
+}
+
+// Multi-threaded benchmarks share one populated map per configuration. Only
+// the most recent one is kept, since the 10M-entry maps are large.
+static std::mutex gSharedLock;
+static Hashmap* gShared;
+static unsigned gSharedFlags;
+static size_t gSharedSize;
+
+static Hashmap* SharedMap(unsigned flags, size_t size) {
+    std::lock_guard<std::mutex> guard(gSharedLock);
+    if (gShared == nullptr || gSharedFlags != flags || gSharedSize != size) {
+        if (gShared != nullptr) hashmapFree(gShared);
+        gShared = hashmapCreateWithFlags(size, int_hash, int_equals, flags);
+        for (uintptr_t i = 1; i <= size; i++) {
+            hashmapPut(gShared, K(i), K(i));
+        }
+        gSharedFlags = flags;
+        gSharedSize = size;
+    }
+    return gShared;
+}
+
+static void BM_hashmap_put(benchmark::State& state, unsigned flags) {
+    const size_t size = state.range(0);
+    while (state.KeepRunning()) {
+        Hashmap* map = hashmapCreateWithFlags(0, int_hash, int_equals, flags);
+        for (uintptr_t i = 1; i <= size; i++) {
+            hashmapPut(map, K(i), K(i));
+        }
+        state.PauseTiming();
+        hashmapFree(map);
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * size);
+}
+BENCHMARK_CAPTURE(BM_hashmap_put, chained, 0u)->RangeMultiplier(10)->Range(1000, 10000000);
+BENCHMARK_CAPTURE(BM_hashmap_put, flat, HASHMAP_FLAG_FLAT)
+        ->RangeMultiplier(10)->Range(1000, 10000000);
+
+// Readers that must take the lock because a writer may be running, which is
+// how callers have to use the chained table.
+static void BM_hashmap_get_locked(benchmark::State& state, unsigned flags) {
+    const size_t size = state.range(0);
+    Hashmap* map = SharedMap(flags, size);
+    uintptr_t i = 0;
+    while (state.KeepRunning()) {
+        hashmapLock(map);
+        benchmark::DoNotOptimize(hashmapGet(map, K(i % size + 1)));
+        hashmapUnlock(map);
+        i += 7919;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_CAPTURE(BM_hashmap_get_locked, chained, 0u)
+        ->RangeMultiplier(10)->Range(1000, 10000000)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK_CAPTURE(BM_hashmap_get_locked, flat, HASHMAP_FLAG_FLAT)
+        ->RangeMultiplier(10)->Range(1000, 10000000)->ThreadRange(1, 16)->UseRealTime();
+
+// Readers that rely on HASHMAP_FLAG_CONCURRENT_READS instead of the lock.
+static void BM_hashmap_get_concurrent(benchmark::State& state) {
+    const size_t size = state.range(0);
+    Hashmap* map = SharedMap(HASHMAP_FLAG_CONCURRENT_READS, size);
+    uintptr_t i = 0;
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(hashmapGet(map, K(i % size + 1)));
+        i += 7919;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_hashmap_get_concurrent)
+        ->RangeMultiplier(10)->Range(1000, 10000000)->ThreadRange(1, 16)->UseRealTime();
+
+static void ReportLatencies(benchmark::State& state, std::vector<int64_t>* latencies) {
+    if (latencies->empty()) return;
+    std::sort(latencies->begin(), latencies->end());
+    state.counters["p50_ns"] = (*latencies)[latencies->size() / 2];
+    state.counters["p99_ns"] = (*latencies)[latencies->size() * 99 / 100];
+    state.counters["max_ns"] = latencies->back();
+}
+
+// Per-put latency while growing a map from empty, which crosses a resize at
+// every power of two. Without HASHMAP_FLAG_INCREMENTAL_RESIZE the put that
+// triggers each resize rehashes the whole table.
+static void BM_hashmap_put_latency(benchmark::State& state, unsigned flags) {
+    const size_t size = state.range(0);
+    std::vector<int64_t> latencies;
+    latencies.reserve(size);
+    while (state.KeepRunning()) {
+        state.PauseTiming();
+        latencies.clear();
+        Hashmap* map = hashmapCreateWithFlags(0, int_hash, int_equals, flags);
+        state.ResumeTiming();
+        for (uintptr_t i = 1; i <= size; i++) {
+            auto start = std::chrono::steady_clock::now();
+            hashmapPut(map, K(i), K(i));
+            latencies.push_back((std::chrono::steady_clock::now() - start).count());
+        }
+        state.PauseTiming();
+        hashmapFree(map);
+        state.ResumeTiming();
+    }
+    ReportLatencies(state, &latencies);
+}
+BENCHMARK_CAPTURE(BM_hashmap_put_latency, chained, 0u)->Arg(1000000)->Arg(4000000);
+BENCHMARK_CAPTURE(BM_hashmap_put_latency, incremental, HASHMAP_FLAG_INCREMENTAL_RESIZE)
+        ->Arg(1000000)->Arg(4000000);
+
+// Per-get latency for a reader sharing the lock with a writer that keeps
+// growing the map, so readers wait behind every resize.
+static void BM_hashmap_get_latency(benchmark::State& state, unsigned flags) {
+    const size_t size = state.range(0);
+    Hashmap* map = hashmapCreateWithFlags(0, int_hash, int_equals, flags);
+    for (uintptr_t i = 1; i <= 1000; i++) {
+        hashmapPut(map, K(i), K(i));
+    }
+
+    std::atomic<bool> done(false);
+    std::thread writer([&]() {
+        for (uintptr_t i = 1001; i <= size && !done; i++) {
+            hashmapLock(map);
+            hashmapPut(map, K(i), K(i));
+            hashmapUnlock(map);
+        }
+    });
+
+    std::vector<int64_t> latencies;
+    uintptr_t i = 0;
+    while (state.KeepRunning()) {
+        auto start = std::chrono::steady_clock::now();
+        hashmapLock(map);
+        benchmark::DoNotOptimize(hashmapGet(map, K(i++ % 1000 + 1)));
+        hashmapUnlock(map);
+        latencies.push_back((std::chrono::steady_clock::now() - start).count());
+    }
+
+    done = true;
+    writer.join();
+    hashmapFree(map);
+    ReportLatencies(state, &latencies);
+}
+BENCHMARK_CAPTURE(BM_hashmap_get_latency, chained, 0u)->Arg(4000000)->UseRealTime();
+BENCHMARK_CAPTURE(BM_hashmap_get_latency, incremental, HASHMAP_FLAG_INCREMENTAL_RESIZE)
+        ->Arg(4000000)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,454 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hashmap_flat.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <new>
+
+/*
+ * Entries live in groups of eight slots. Each group has one 64-bit control
+ * word holding a control byte per slot: kEmpty, kDeleted, or the top seven
+ * bits of the slot's hash when full. A lookup matches all eight control
+ * bytes at once and only touches slots whose tag matches.
+ *
+ * When concurrent reads are enabled, a writer makes each group's sequence
+ * counter odd while it modifies the group, and readers retry a group whose
+ * counter was odd or changed while they read it. Tables replaced by a
+ * resize are kept until the map is freed so that a reader can never touch
+ * freed memory.
+ */
+
+static constexpr size_t kGroupSize = 8;
+static constexpr uint8_t kEmpty = 0x80;
+static constexpr uint8_t kDeleted = 0xfe;
+static constexpr uint64_t kLsbs = 0x0101010101010101ULL;
+static constexpr uint64_t kMsbs = 0x8080808080808080ULL;
+
+struct FlatSlot {
+    std::atomic<void*> key;
+    std::atomic<void*> value;
+    std::atomic<int> hash;
+};
+
+struct FlatGroup {
+    std::atomic<uint64_t> ctrl;
+    std::atomic<uint32_t> seq;
+    FlatSlot slots[kGroupSize];
+};
+
+struct FlatTable {
+    FlatGroup* groups;
+    size_t groupCount;
+    FlatTable* retired;
+};
+
+struct FlatHashmap {
+    std::atomic<FlatTable*> table;
+    size_t size;
+    size_t tombstones;
+    bool concurrentReads;
+    FlatTable* retired;
+};
+
+static inline uint64_t mixHash(int hash) {
+    return static_cast<uint64_t>(static_cast<uint32_t>(hash)) * 0x9e3779b97f4a7c15ULL;
+}
+
+static inline uint8_t tagOf(uint64_t mixed) {
+    return static_cast<uint8_t>(mixed >> 57);
+}
+
+static inline size_t groupOf(uint64_t mixed, size_t groupCount) {
+    return static_cast<size_t>(mixed >> 20) & (groupCount - 1);
+}
+
+/* May report false positives, but only for full slots; callers compare hashes anyway. */
+static inline uint64_t matchTag(uint64_t ctrl, uint8_t tag) {
+    uint64_t x = ctrl ^ (kLsbs * tag);
+    return (x - kLsbs) & ~x & kMsbs;
+}
+
+static inline uint64_t matchEmpty(uint64_t ctrl) {
+    return ctrl & (~ctrl << 6) & kMsbs;
+}
+
+static inline uint64_t matchEmptyOrDeleted(uint64_t ctrl) {
+    return ctrl & (~ctrl << 7) & kMsbs;
+}
+
+static inline size_t lowestSlot(uint64_t mask) {
+    return __builtin_ctzll(mask) >> 3;
+}
+
+static inline uint64_t withCtrlByte(uint64_t ctrl, size_t slot, uint8_t b) {
+    return (ctrl & ~(0xffULL << (slot * 8))) | (static_cast<uint64_t>(b) << (slot * 8));
+}
+
+static inline size_t capacityOf(const FlatTable* table) {
+    return table->groupCount * kGroupSize;
+}
+
+/* Up to 7/8 of the slots, counting tombstones, may be in use before a resize. */
+static inline size_t maxLoad(size_t capacity) {
+    return capacity - capacity / 8;
+}
+
+static FlatTable* createTable(size_t groupCount) {
+    FlatTable* table = new (std::nothrow) FlatTable;
+    if (table == NULL) {
+        return NULL;
+    }
+    table->groups = new (std::nothrow) FlatGroup[groupCount]();
+    if (table->groups == NULL) {
+        delete table;
+        return NULL;
+    }
+    for (size_t i = 0; i < groupCount; i++) {
+        table->groups[i].ctrl.store(kEmpty * kLsbs, std::memory_order_relaxed);
+    }
+    table->groupCount = groupCount;
+    table->retired = NULL;
+    return table;
+}
+
+static void freeTable(FlatTable* table) {
+    delete[] table->groups;
+    delete table;
+}
+
+static inline void beginWrite(FlatHashmap* map, FlatGroup* group) {
+    if (map->concurrentReads) {
+        group->seq.store(group->seq.load(std::memory_order_relaxed) + 1,
+                         std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+}
+
+static inline void endWrite(FlatHashmap* map, FlatGroup* group) {
+    if (map->concurrentReads) {
+        group->seq.store(group->seq.load(std::memory_order_relaxed) + 1,
+                         std::memory_order_release);
+    }
+}
+
+FlatHashmap* flatHashmapCreate(size_t initialCapacity, bool concurrentReads) {
+    FlatHashmap* map = new (std::nothrow) FlatHashmap;
+    if (map == NULL) {
+        return NULL;
+    }
+
+    size_t groupCount = 1;
+    while (maxLoad(groupCount * kGroupSize) < initialCapacity) {
+        // Group count must be power of 2.
+        groupCount <<= 1;
+    }
+
+    FlatTable* table = createTable(groupCount);
+    if (table == NULL) {
+        delete map;
+        return NULL;
+    }
+
+    map->table.store(table, std::memory_order_relaxed);
+    map->size = 0;
+    map->tombstones = 0;
+    map->concurrentReads = concurrentReads;
+    map->retired = NULL;
+    return map;
+}
+
+void flatHashmapFree(FlatHashmap* map) {
+    freeTable(map->table.load(std::memory_order_relaxed));
+    while (map->retired != NULL) {
+        FlatTable* next = map->retired->retired;
+        freeTable(map->retired);
+        map->retired = next;
+    }
+    delete map;
+}
+
+/**
+ * Finds the first empty or deleted slot on the probe sequence for mixed.
+ * Returns false if the table has no such slot.
+ */
+static bool findFreeSlot(const FlatTable* table, uint64_t mixed, size_t* groupIndex,
+                         size_t* slot) {
+    size_t mask = table->groupCount - 1;
+    size_t g = groupOf(mixed, table->groupCount);
+    for (size_t step = 0; step < table->groupCount; step++) {
+        uint64_t ctrl = table->groups[g].ctrl.load(std::memory_order_relaxed);
+        uint64_t free = matchEmptyOrDeleted(ctrl);
+        if (free != 0) {
+            *groupIndex = g;
+            *slot = lowestSlot(free);
+            return true;
+        }
+        g = (g + step + 1) & mask;
+    }
+    return false;
+}
+
+/**
+ * Moves every entry into a new table and publishes it. Keeps the current
+ * table size if enough of the load is tombstones, doubles it otherwise.
+ */
+static bool rehash(FlatHashmap* map) {
+    FlatTable* oldTable = map->table.load(std::memory_order_relaxed);
+    size_t groupCount = oldTable->groupCount;
+    if (map->size >= maxLoad(capacityOf(oldTable)) / 2) {
+        groupCount <<= 1;
+    }
+
+    FlatTable* newTable = createTable(groupCount);
+    if (newTable == NULL) {
+        return false;
+    }
+
+    for (size_t g = 0; g < oldTable->groupCount; g++) {
+        FlatGroup* group = &oldTable->groups[g];
+        uint64_t full = ~group->ctrl.load(std::memory_order_relaxed) & kMsbs;
+        for (; full != 0; full &= full - 1) {
+            size_t i = lowestSlot(full);
+            int hash = group->slots[i].hash.load(std::memory_order_relaxed);
+            uint64_t mixed = mixHash(hash);
+            size_t ng, ns;
+            // The new table is at least as large as the live entries, so this can't fail.
+            findFreeSlot(newTable, mixed, &ng, &ns);
+            FlatGroup* target = &newTable->groups[ng];
+            target->slots[ns].hash.store(hash, std::memory_order_relaxed);
+            target->slots[ns].key.store(group->slots[i].key.load(std::memory_order_relaxed),
+                                   std::memory_order_relaxed);
+            target->slots[ns].value.store(group->slots[i].value.load(std::memory_order_relaxed),
+                                     std::memory_order_relaxed);
+            target->ctrl.store(withCtrlByte(target->ctrl.load(std::memory_order_relaxed), ns,
+                                            tagOf(mixed)),
+                               std::memory_order_relaxed);
+        }
+    }
+
+    map->table.store(newTable, std::memory_order_release);
+    map->tombstones = 0;
+    if (map->concurrentReads) {
+        oldTable->retired = map->retired;
+        map->retired = oldTable;
+    } else {
+        freeTable(oldTable);
+    }
+    return true;
+}
+
+static inline bool equalKeys(void* keyA, int hashA, void* keyB, int hashB,
+        bool (*equals)(void*, void*)) {
+    if (keyA == keyB) {
+        return true;
+    }
+    if (hashA != hashB) {
+        return false;
+    }
+    return equals(keyA, keyB);
+}
+
+/**
+ * Finds the slot holding key. Only called by writers, which are serialized
+ * by the caller, so no validation is needed.
+ */
+static bool findSlot(const FlatTable* table, uint64_t mixed, int hash, void* key,
+                     bool (*equals)(void*, void*), size_t* groupIndex, size_t* slot) {
+    size_t mask = table->groupCount - 1;
+    size_t g = groupOf(mixed, table->groupCount);
+    uint8_t tag = tagOf(mixed);
+    for (size_t step = 0; step < table->groupCount; step++) {
+        FlatGroup* group = &table->groups[g];
+        uint64_t ctrl = group->ctrl.load(std::memory_order_relaxed);
+        for (uint64_t match = matchTag(ctrl, tag); match != 0; match &= match - 1) {
+            size_t i = lowestSlot(match);
+            if (equalKeys(group->slots[i].key.load(std::memory_order_relaxed),
+                          group->slots[i].hash.load(std::memory_order_relaxed), key, hash, equals)) {
+                *groupIndex = g;
+                *slot = i;
+                return true;
+            }
+        }
+        if (matchEmpty(ctrl) != 0) {
+            return false;
+        }
+        g = (g + step + 1) & mask;
+    }
+    return false;
+}
+
+void* flatHashmapPut(FlatHashmap* map, int hash, void* key, void* value,
+        bool (*equals)(void*, void*)) {
+    uint64_t mixed = mixHash(hash);
+    FlatTable* table = map->table.load(std::memory_order_relaxed);
+    size_t g, i;
+
+    // Replace existing entry.
+    if (findSlot(table, mixed, hash, key, equals, &g, &i)) {
+        FlatGroup* group = &table->groups[g];
+        void* oldValue = group->slots[i].value.load(std::memory_order_relaxed);
+        beginWrite(map, group);
+        group->slots[i].value.store(value, std::memory_order_relaxed);
+        endWrite(map, group);
+        return oldValue;
+    }
+
+    // Add a new entry, growing first if it would take the table past its load limit.
+    if (map->size + map->tombstones >= maxLoad(capacityOf(table))) {
+        // If the table can't grow, keep filling it until it is completely full.
+        if (rehash(map)) {
+            table = map->table.load(std::memory_order_relaxed);
+        }
+    }
+    if (!findFreeSlot(table, mixed, &g, &i)) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    FlatGroup* group = &table->groups[g];
+    uint64_t ctrl = group->ctrl.load(std::memory_order_relaxed);
+    if (((ctrl >> (i * 8)) & 0xff) == kDeleted) {
+        map->tombstones--;
+    }
+    beginWrite(map, group);
+    group->slots[i].hash.store(hash, std::memory_order_relaxed);
+    group->slots[i].key.store(key, std::memory_order_relaxed);
+    group->slots[i].value.store(value, std::memory_order_relaxed);
+    group->ctrl.store(withCtrlByte(ctrl, i, tagOf(mixed)), std::memory_order_relaxed);
+    endWrite(map, group);
+    map->size++;
+    return NULL;
+}
+
+enum ReadResult { kFound, kNotFound, kRetry };
+
+/**
+ * Looks key up without the lock. Returns kRetry if a writer touched a group
+ * or replaced the table while it was being read.
+ */
+static ReadResult readSlot(FlatHashmap* map, uint64_t mixed, int hash, void* key,
+                           bool (*equals)(void*, void*), void** value) {
+    FlatTable* table = map->table.load(std::memory_order_acquire);
+    size_t mask = table->groupCount - 1;
+    size_t g = groupOf(mixed, table->groupCount);
+    uint8_t tag = tagOf(mixed);
+    ReadResult result = kNotFound;
+    for (size_t step = 0; step < table->groupCount; step++) {
+        FlatGroup* group = &table->groups[g];
+        uint32_t seq = group->seq.load(std::memory_order_acquire);
+        if (seq & 1) {
+            return kRetry;
+        }
+        uint64_t ctrl = group->ctrl.load(std::memory_order_relaxed);
+        for (uint64_t match = matchTag(ctrl, tag); match != 0; match &= match - 1) {
+            size_t i = lowestSlot(match);
+            int slotHash = group->slots[i].hash.load(std::memory_order_relaxed);
+            void* slotKey = group->slots[i].key.load(std::memory_order_relaxed);
+            void* slotValue = group->slots[i].value.load(std::memory_order_relaxed);
+            // Validate the snapshot before handing the key to equals().
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (group->seq.load(std::memory_order_relaxed) != seq) {
+                return kRetry;
+            }
+            if (equalKeys(slotKey, slotHash, key, hash, equals)) {
+                *value = slotValue;
+                result = kFound;
+                break;
+            }
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (group->seq.load(std::memory_order_relaxed) != seq) {
+            return kRetry;
+        }
+        if (result == kFound || matchEmpty(ctrl) != 0) {
+            break;
+        }
+        g = (g + step + 1) & mask;
+    }
+
+    // A resize may have moved the entry while we were probing the old table.
+    if (map->table.load(std::memory_order_acquire) != table) {
+        return kRetry;
+    }
+    return result;
+}
+
+void* flatHashmapGet(FlatHashmap* map, int hash, void* key, bool (*equals)(void*, void*)) {
+    uint64_t mixed = mixHash(hash);
+
+    if (!map->concurrentReads) {
+        FlatTable* table = map->table.load(std::memory_order_relaxed);
+        size_t g, i;
+        if (findSlot(table, mixed, hash, key, equals, &g, &i)) {
+            return table->groups[g].slots[i].value.load(std::memory_order_relaxed);
+        }
+        return NULL;
+    }
+
+    void* value;
+    ReadResult result;
+    while ((result = readSlot(map, mixed, hash, key, equals, &value)) == kRetry) {
+    }
+    return result == kFound ? value : NULL;
+}
+
+void* flatHashmapRemove(FlatHashmap* map, int hash, void* key, bool (*equals)(void*, void*)) {
+    FlatTable* table = map->table.load(std::memory_order_relaxed);
+    size_t g, i;
+    if (!findSlot(table, mixHash(hash), hash, key, equals, &g, &i)) {
+        return NULL;
+    }
+
+    FlatGroup* group = &table->groups[g];
+    void* value = group->slots[i].value.load(std::memory_order_relaxed);
+    uint64_t ctrl = group->ctrl.load(std::memory_order_relaxed);
+    // A slot in a group that has never been full can go straight back to
+    // empty, since no probe sequence has continued past this group.
+    uint8_t b = matchEmpty(ctrl) != 0 ? kEmpty : kDeleted;
+    beginWrite(map, group);
+    group->ctrl.store(withCtrlByte(ctrl, i, b), std::memory_order_relaxed);
+    group->slots[i].key.store(NULL, std::memory_order_relaxed);
+    group->slots[i].value.store(NULL, std::memory_order_relaxed);
+    endWrite(map, group);
+    map->size--;
+    if (b == kDeleted) {
+        map->tombstones++;
+    }
+    return value;
+}
+
+void flatHashmapForEach(FlatHashmap* map, bool (*callback)(void* key, void* value, void* context),
+        void* context) {
+    // The callback may remove entries, so reload the control word for every slot.
+    for (size_t g = 0; g < map->table.load(std::memory_order_relaxed)->groupCount; g++) {
+        FlatGroup* group = &map->table.load(std::memory_order_relaxed)->groups[g];
+        for (size_t i = 0; i < kGroupSize; i++) {
+            uint64_t ctrl = group->ctrl.load(std::memory_order_relaxed);
+            if ((ctrl >> (i * 8)) & 0x80) {
+                continue;
+            }
+            if (!callback(group->slots[i].key.load(std::memory_order_relaxed),
+                          group->slots[i].value.load(std::memory_order_relaxed), context)) {
+                return;
+            }
+        }
+    }
+}
@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __HASHMAP_FLAT_H
+#define __HASHMAP_FLAT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Open-addressing engine behind HASHMAP_FLAG_FLAT. Hashmap owns the hash and
+ * equals callbacks and the lock; these functions take an already-mixed hash.
+ */
+typedef struct FlatHashmap FlatHashmap;
+
+FlatHashmap* flatHashmapCreate(size_t initialCapacity, bool concurrentReads);
+void flatHashmapFree(FlatHashmap* map);
+
+void* flatHashmapPut(FlatHashmap* map, int hash, void* key, void* value,
+        bool (*equals)(void*, void*));
+void* flatHashmapGet(FlatHashmap* map, int hash, void* key, bool (*equals)(void*, void*));
+void* flatHashmapRemove(FlatHashmap* map, int hash, void* key, bool (*equals)(void*, void*));
+void flatHashmapForEach(FlatHashmap* map, bool (*callback)(void* key, void* value, void* context),
+        void* context);
+
+#endif /* __HASHMAP_FLAT_H */
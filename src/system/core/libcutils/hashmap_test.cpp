@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cutils/hashmap.h>
+
+#include <stdint.h>
+
+#include <atomic>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+static int int_hash(void* key) {
+    return static_cast<int>(reinterpret_cast<uintptr_t>(key));
+}
+
+static bool int_equals(void* a, void* b) {
+    return a == b;
+}
+
+// A deliberately bad hash, so that every key collides.
+static int const_hash(void*) {
+    return 42;
+}
+
+static void* K(uintptr_t i) {
+    return reinterpret_cast<void*>(i);
+}
+
+static bool count_entry(void*, void*, void* context) {
+    (*static_cast<size_t*>(context))++;
+    return true;
+}
+
+class HashmapTest : public ::testing::TestWithParam<unsigned> {};
+
+TEST_P(HashmapTest, put_get_remove) {
+    Hashmap* map = hashmapCreateWithFlags(0, int_hash, int_equals, GetParam());
+    ASSERT_NE(nullptr, map);
+
+    const uintptr_t kCount = 10000;
+    for (uintptr_t i = 1; i <= kCount; i++) {
+        ASSERT_EQ(nullptr, hashmapPut(map, K(i), K(i * 2)));
+    }
+    for (uintptr_t i = 1; i <= kCount; i++) {
+        ASSERT_EQ(K(i * 2), hashmapGet(map, K(i))) << i;
+    }
+    ASSERT_EQ(nullptr, hashmapGet(map, K(kCount + 1)));
+
+    // Replacing returns the old value.
+    ASSERT_EQ(K(2), hashmapPut(map, K(1), K(3)));
+    ASSERT_EQ(K(3), hashmapGet(map, K(1)));
+
+    for (uintptr_t i = 1; i <= kCount; i += 2) {
+        ASSERT_NE(nullptr, hashmapRemove(map, K(i)));
+    }
+    ASSERT_EQ(nullptr, hashmapRemove(map, K(1)));
+    for (uintptr_t i = 1; i <= kCount; i++) {
+        ASSERT_EQ((i % 2) ? nullptr : K(i * 2), hashmapGet(map, K(i))) << i;
+    }
+
+    size_t count = 0;
+    hashmapForEach(map, count_entry, &count);
+    ASSERT_EQ(kCount / 2, count);
+
+    hashmapFree(map);
+}
+
+TEST_P(HashmapTest, collisions_and_reuse) {
+    Hashmap* map = hashmapCreateWithFlags(4, const_hash, int_equals, GetParam());
+    ASSERT_NE(nullptr, map);
+
+    // Churn through many more keys than the table ever holds at once, so
+    // removed slots have to be reused or purged.
+    for (uintptr_t round = 0; round < 100; round++) {
+        for (uintptr_t i = 1; i <= 50; i++) {
+            ASSERT_EQ(nullptr, hashmapPut(map, K(round * 1000 + i), K(i)));
+        }
+        for (uintptr_t i = 1; i <= 50; i++) {
+            ASSERT_EQ(K(i), hashmapGet(map, K(round * 1000 + i)));
+            ASSERT_EQ(K(i), hashmapRemove(map, K(round * 1000 + i)));
+        }
+    }
+
+    size_t count = 0;
+    hashmapForEach(map, count_entry, &count);
+    ASSERT_EQ(0u, count);
+
+    hashmapFree(map);
+}
+
+static bool remove_entry(void* key, void*, void* context) {
+    hashmapRemove(static_cast<Hashmap*>(context), key);
+    return true;
+}
+
+TEST_P(HashmapTest, remove_during_for_each) {
+    Hashmap* map = hashmapCreateWithFlags(0, int_hash, int_equals, GetParam());
+    ASSERT_NE(nullptr, map);
+
+    // 97 entries leaves an incremental resize part way through.
+    for (uintptr_t i = 1; i <= 97; i++) {
+        hashmapPut(map, K(i), K(i));
+    }
+    hashmapForEach(map, remove_entry, map);
+
+    size_t count = 0;
+    hashmapForEach(map, count_entry, &count);
+    ASSERT_EQ(0u, count);
+
+    hashmapFree(map);
+}
+
+INSTANTIATE_TEST_SUITE_P(engines, HashmapTest,
+                         ::testing::Values(0u, HASHMAP_FLAG_FLAT, HASHMAP_FLAG_CONCURRENT_READS,
+                                           HASHMAP_FLAG_INCREMENTAL_RESIZE));
+
+TEST(hashmap, concurrent_reads) {
+    Hashmap* map = hashmapCreateWithFlags(0, int_hash, int_equals, HASHMAP_FLAG_CONCURRENT_READS);
+    ASSERT_NE(nullptr, map);
+
+    // Keys below kStable are never touched by the writer, so readers must
+    // always find them, even while the table is being resized.
+    const uintptr_t kStable = 1000;
+    for (uintptr_t i = 1; i <= kStable; i++) {
+        hashmapPut(map, K(i), K(i));
+    }
+
+    std::atomic<bool> done(false);
+    std::atomic<size_t> misses(0);
+    std::thread readers[4];
+    for (auto& reader : readers) {
+        reader = std::thread([&]() {
+            while (!done.load()) {
+                for (uintptr_t i = 1; i <= kStable; i++) {
+                    if (hashmapGet(map, K(i)) != K(i)) misses++;
+                }
+            }
+        });
+    }
+
+    for (uintptr_t i = kStable + 1; i <= 200000; i++) {
+        hashmapLock(map);
+        hashmapPut(map, K(i), K(i));
+        if (i % 3 == 0) hashmapRemove(map, K(i - 1));
+        hashmapUnlock(map);
+    }
+    done = true;
+    for (auto& reader : readers) reader.join();
+
+    ASSERT_EQ(0u, misses.load());
+    hashmapFree(map);
+}
@@ -27,6 +27,53 @@ int ashmem_pin_region(int fd, size_t offset, size_t len);
 int ashmem_unpin_region(int fd, size_t offset, size_t len);
 int ashmem_get_size_region(int fd);
 
+/*
+ * A pool of mapped regions, recycled by size class, for callers that create
+ * and drop many short-lived buffers. Getting a cached region costs no
+ * syscalls beyond optional prefaulting; returning one releases its pages
+ * (lazily where the kernel allows) but keeps the fd and mapping for reuse.
+ *
+ * Only return a region once nobody else can still use it: a region whose fd
+ * was sent to another process must be closed, not returned, unless that
+ * process is known to be done with it. Regions that were sealed or had
+ * PROT_WRITE removed with ashmem_set_prot_region() are closed on return
+ * rather than reused. A region can always be kept instead: munmap() and
+ * close() are all it takes to free it outside the pool.
+ */
+struct ashmem_pool;
+
+struct ashmem_region {
+    int fd;
+    void* addr;     /* Shared, read-write mapping of the whole region. */
+    size_t size;    /* The region's size, rounded up to its size class. */
+};
+
+/* Prefault the requested size of each region before returning it. */
+#define ASHMEM_POOL_PREFAULT    0x1
+/*
+ * Keep the pages of returned regions. Reuse is then cheaper, but regions are
+ * no longer zero-filled: they hold whatever their last user left in them.
+ */
+#define ASHMEM_POOL_KEEP_PAGES  0x2
+
+/*
+ * Creates a pool that caches up to max_cached_bytes of returned regions.
+ * name labels every region the pool creates. Returns NULL on failure.
+ */
+struct ashmem_pool* ashmem_pool_create(const char* name, size_t max_cached_bytes, int flags);
+
+/* Closes the pool's cached regions. Regions still out must not be returned. */
+void ashmem_pool_destroy(struct ashmem_pool* pool);
+
+/*
+ * Fills in a region of at least size bytes, reusing a cached one if it can.
+ * Returns 0 on success, or -1 with errno set.
+ */
+int ashmem_pool_get(struct ashmem_pool* pool, size_t size, struct ashmem_region* region);
+
+/* Returns a region to the pool, or frees it if the pool can't reuse it. */
+void ashmem_pool_put(struct ashmem_pool* pool, struct ashmem_region* region);
+
 #ifdef __cplusplus
 }
 #endif
@@ -57,6 +57,35 @@ void config_set(cnode *root, const char *name, const char *value);
 /* free a config node tree */
 void config_free(cnode *root);
 
+/* An arena holds a config tree whose nodes are allocated in bulk and freed
+ * all at once. Names and values point into the parsed text, which must
+ * outlive the arena (files loaded with config_arena_load_file() are kept by
+ * the arena). Once a block has more than a few children, they are indexed
+ * by name, so config_arena_find() doesn't have to scan them.
+ *
+ * Arena trees can be read with config_find(), config_str() and
+ * config_bool(), but must not be passed to config_set() or config_free().
+ */
+typedef struct config_arena config_arena;
+
+/* create an arena with an empty root node; returns NULL on failure */
+config_arena* config_arena_create(void);
+
+/* the root node of an arena's tree */
+cnode* config_arena_root(config_arena *arena);
+
+/* parse a text string into an arena's tree */
+void config_arena_load(config_arena *arena, char *data);
+
+/* parse a file into an arena's tree; returns -1 if it can't be read */
+int config_arena_load_file(config_arena *arena, const char *fn);
+
+/* like config_find(), for a node of an arena tree */
+cnode* config_arena_find(cnode *root, const char *name);
+
+/* free an arena, its tree and any files it loaded */
+void config_arena_free(config_arena *arena);
+
 #ifdef __cplusplus
 }
 #endif
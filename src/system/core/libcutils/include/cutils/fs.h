@@ -17,6 +17,7 @@
 #ifndef __CUTILS_FS_H
 #define __CUTILS_FS_H
 
+#include <stddef.h>
 #include <sys/types.h>
 #include <unistd.h>
 
@@ -57,6 +58,27 @@ extern int fs_prepare_dir_strict(const char* path, mode_t mode, uid_t uid, gid_t
  */
 extern int fs_prepare_file_strict(const char* path, mode_t mode, uid_t uid, gid_t gid);
 
+struct fs_dir_spec {
+    const char* path;
+    mode_t mode;
+    uid_t uid;
+    gid_t gid;
+};
+
+/*
+ * Call fs_prepare_dir() on each of count directories in order, stopping at
+ * the first failure.  The parent of each directory must already exist or
+ * come earlier in dirs.  Parents are opened once and then used for every
+ * directory below them, so listing dirs in sorted order means each entry
+ * costs a lookup of its last component only.
+ */
+extern int fs_prepare_dirs(const struct fs_dir_spec* dirs, size_t count);
+
+/*
+ * Like fs_prepare_dirs(), but calls fs_prepare_dir_strict() on each.
+ */
+extern int fs_prepare_dirs_strict(const struct fs_dir_spec* dirs, size_t count);
+
 
 /*
  * Read single plaintext integer from given file, correctly handling files
@@ -66,10 +88,45 @@ extern int fs_read_atomic_int(const char* path, int* value);
 
 /*
  * Write single plaintext integer to given file, creating backup while
- * in progress.
+ * in progress.  Equivalent to fs_write_atomic() with no fsync flags.
  */
 extern int fs_write_atomic_int(const char* path, int value);
 
+/* fdatasync() each new file before it replaces the old one. */
+#define FS_WRITE_ATOMIC_FSYNC       0x1
+/* fsync() the directory once its entries have been replaced. */
+#define FS_WRITE_ATOMIC_FSYNC_DIR   0x2
+/* Both of the above: the new contents survive a crash once the call returns. */
+#define FS_WRITE_ATOMIC_DURABLE     (FS_WRITE_ATOMIC_FSYNC | FS_WRITE_ATOMIC_FSYNC_DIR)
+
+/*
+ * Replace the contents of given file with len bytes of data.  Readers see
+ * either the old or the new contents, never a mix.  The new file gets the
+ * given mode; flags is a mask of FS_WRITE_ATOMIC_* values and defaults to
+ * no fsyncs at all.  Uses an unnamed O_TMPFILE file where the filesystem
+ * supports it, so a crash never leaves a partially written file behind.
+ * Returns 0 on success, or -1 with errno set.
+ */
+extern int fs_write_atomic(const char* path, const void* data, size_t len, mode_t mode,
+                           int flags);
+
+struct fs_atomic_file {
+    const char* name;  /* Entry in the directory; must not contain '/'. */
+    const void* data;
+    size_t len;
+};
+
+/*
+ * Like fs_write_atomic() for several files in one directory.  Every file is
+ * written (and synced, with FS_WRITE_ATOMIC_FSYNC) before any of them
+ * replaces its old version, and FS_WRITE_ATOMIC_FSYNC_DIR costs a single
+ * directory fsync for the whole batch.  Each file is replaced atomically,
+ * but the batch as a whole is not: if a rename fails, the files before it
+ * have already been replaced.  Returns 0 on success, or -1 with errno set.
+ */
+extern int fs_write_atomic_batch(const char* dir, const struct fs_atomic_file* files,
+                                 size_t count, mode_t mode, int flags);
+
 /*
  * Ensure that all directories along given path exist, creating parent
  * directories as needed.  Validates that given path is absolute and that
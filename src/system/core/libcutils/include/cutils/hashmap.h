@@ -44,6 +44,46 @@ typedef struct Hashmap Hashmap;
 Hashmap* hashmapCreate(size_t initialCapacity,
         int (*hash)(void* key), bool (*equals)(void* keyA, void* keyB));
 
+/** Flags for hashmapCreateWithFlags(). */
+enum {
+    /**
+     * Uses an open-addressing table that stores each entry's hash inline
+     * next to its key and value, with a control byte per slot, instead of
+     * allocating one chained entry per put.
+     */
+    HASHMAP_FLAG_FLAT = 1 << 0,
+
+    /**
+     * Implies HASHMAP_FLAG_FLAT. hashmapGet() may be called without holding
+     * the map's lock, concurrently with one writer that does hold it.
+     * Readers are validated against per-bucket sequence counters and never
+     * take the lock.
+     *
+     * Since a reader may still be comparing against a key that a writer has
+     * just removed, removed keys must stay valid until no such reader can be
+     * running.
+     */
+    HASHMAP_FLAG_CONCURRENT_READS = 1 << 1,
+
+    /**
+     * Spreads each resize of the default table over later puts instead of
+     * rehashing every entry in the put that crosses the load factor. Old
+     * and new buckets are kept side by side and each hashmapPut() moves a
+     * few old buckets. hashmapGet() and hashmapRemove() never move entries,
+     * so removing from a hashmapForEach() callback stays safe. Ignored with
+     * HASHMAP_FLAG_FLAT, which has no per-entry chains to move.
+     */
+    HASHMAP_FLAG_INCREMENTAL_RESIZE = 1 << 2,
+};
+
+/**
+ * Creates a new hash map like hashmapCreate(), with the storage engine
+ * selected by flags (a combination of HASHMAP_FLAG_* values). Returns NULL
+ * if memory allocation fails.
+ */
+Hashmap* hashmapCreateWithFlags(size_t initialCapacity,
+        int (*hash)(void* key), bool (*equals)(void* keyA, void* keyB), unsigned flags);
+
 /**
  * Frees the hash map. Does not free the keys or values themselves.
  */
@@ -17,6 +17,8 @@
 #ifndef __CUTILS_MISC_H
 #define __CUTILS_MISC_H
 
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -28,6 +30,34 @@ extern "C" {
          */
 extern void *load_file(const char *fn, unsigned *sz);
 
+        /* A file loaded by load_file_mapped(). data is always followed
+         * by a null terminator. mapped_size is the size of the mapping
+         * backing data, or 0 if data was read into a malloc'd buffer.
+         */
+struct mapped_file {
+    char *data;
+    size_t size;
+    size_t mapped_size;
+};
+
+        /* Map the file copy-on-write instead of read-only, so that the
+         * caller may modify data without changing the file. Only pages
+         * the caller writes to are copied.
+         */
+#define LOAD_FILE_WRITABLE 0x1
+
+        /* Load an entire file like load_file(), but by mapping regular
+         * files rather than copying them, with the kernel told to read
+         * ahead for a front to back scan. Other files (pipes, /proc and
+         * /sys entries, ...) are read in chunks until end of file.
+         * Unless LOAD_FILE_WRITABLE is given, data must not be modified.
+         * Returns 0 on success, or -1 with errno set.
+         */
+extern int load_file_mapped(const char *fn, struct mapped_file *file, int flags);
+
+        /* Release a file loaded by load_file_mapped(). */
+extern void unload_file_mapped(struct mapped_file *file);
+
         /* This is the range of UIDs (and GIDs) that are reserved
          * for assigning to applications.
          */
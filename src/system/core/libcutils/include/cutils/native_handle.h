@@ -18,6 +18,7 @@
 #define NATIVE_HANDLE_H_
 
 #include <stdalign.h>
+#include <stddef.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -98,6 +99,31 @@ native_handle_t* native_handle_clone(const native_handle_t* handle);
  */
 int native_handle_delete(native_handle_t* h);
 
+/*
+ * native_handle_clone_batch
+ *
+ * clones count handles into clones, as native_handle_clone() would.
+ * Either all are cloned, or none are and any partial clones are closed and
+ * deleted again.
+ *
+ * return 0 on success, or -1 with errno set on failure
+ *
+ */
+int native_handle_clone_batch(const native_handle_t* const* handles, size_t count,
+                              native_handle_t** clones);
+
+/*
+ * native_handle_close_batch
+ *
+ * closes the file descriptors of count handles, using as few system calls
+ * as it can. NULL handles are skipped.
+ *
+ * return 0 on success, or a negative error code (with nothing closed) if
+ * any handle is invalid
+ *
+ */
+int native_handle_close_batch(const native_handle_t* const* handles, size_t count);
+
 
 #ifdef __cplusplus
 }
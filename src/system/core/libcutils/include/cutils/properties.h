@@ -19,8 +19,14 @@
 
 #include <sys/cdefs.h>
 #include <stddef.h>
-#include <sys/system_properties.h>
 #include <stdint.h>
+#if __has_include(<sys/system_properties.h>)
+#include <sys/system_properties.h>
+#else
+/* Host builds use the in-process stand-in in properties-host.cpp. */
+#define PROP_NAME_MAX   32
+#define PROP_VALUE_MAX  92
+#endif
 
 #ifdef __cplusplus
 extern "C" {
@@ -103,6 +109,38 @@ int64_t property_get_int64(const char *key, int64_t default_value);
 **/
 int32_t property_get_int32(const char *key, int32_t default_value);
 
+/* cached_property: a property key resolved once, and the last value read
+** from it already parsed. Reading a cached property whose value hasn't
+** changed costs one load of the property's serial number; the value is only
+** read and parsed again after the serial changes. A property that doesn't
+** exist yet is looked up again only when a new property has been added.
+**
+** Initialize with CACHED_PROPERTY_INIT or cached_property_init(); the key
+** must outlive the cached_property. Each cached_property should be read as
+** a single type, and isn't safe to share between threads without locking;
+** give each thread its own (e.g. thread_local) if needed.
+**
+** The conversions and default handling match property_get_bool(),
+** property_get_int64() and property_get_int32() exactly.
+*/
+struct cached_property {
+    const char* key;
+    const void* info;       /* const prop_info*, once the key has been found. */
+    uint32_t serial;        /* The property's serial, or the area serial while
+                               the key hasn't been found. */
+    int8_t type;            /* Which getter parsed value; 0 if none has. */
+    int8_t valid;           /* Whether the value parsed as that type. */
+    int64_t value;
+};
+
+#define CACHED_PROPERTY_INIT(key) { (key), NULL, 0, 0, 0, 0 }
+
+void cached_property_init(struct cached_property* prop, const char* key);
+
+int8_t cached_property_get_bool(struct cached_property* prop, int8_t default_value);
+int64_t cached_property_get_int64(struct cached_property* prop, int64_t default_value);
+int32_t cached_property_get_int32(struct cached_property* prop, int32_t default_value);
+
 /* property_set: returns 0 on success, < 0 on failure
 */
 int property_set(const char *key, const char *value);
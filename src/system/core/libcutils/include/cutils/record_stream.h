@@ -29,12 +29,31 @@ extern "C" {
 
 typedef struct RecordStream RecordStream;
 
+/* A record in the stream's buffer, without its length header. */
+typedef struct {
+    void *data;
+    size_t len;
+} RecordView;
+
 extern RecordStream *record_stream_new(int fd, size_t maxRecordLen);
 extern void record_stream_free(RecordStream *p_rs);
 
 extern int record_stream_get_next (RecordStream *p_rs, void ** p_outRecord, 
                                     size_t *p_outRecordLen);
 
+/*
+ * Returns up to maxRecords complete records at once, as views into the
+ * stream's buffer that stay valid until the next call on the stream. Reads
+ * from fd, with a single read, only if there isn't a complete record
+ * buffered already.
+ *
+ * Returns the number of records, 0 on end of stream, and -1 on failure.
+ * Returns -1 / errno = EAGAIN if it needs to read again, and -1 / errno =
+ * EFBIG if a record is longer than maxRecordLen.
+ */
+extern int record_stream_get_batch (RecordStream *p_rs, RecordView *p_outRecords,
+                                    size_t maxRecords);
+
 #ifdef __cplusplus
 }
 #endif
@@ -132,6 +132,77 @@ ssize_t socket_send_buffers(cutils_socket_t sock,
                             const cutils_socket_buffer_t* buffers,
                             size_t num_buffers);
 
+#if !defined(_WIN32)
+
+/*
+ * An event loop serving the clients of a listening stream socket, such as
+ * one from socket_local_server() or android_get_control_socket(). Only
+ * implemented on Linux, where it uses epoll; elsewhere
+ * socket_server_create() fails with ENOSYS.
+ *
+ * New connections are accepted non-blocking and close-on-exec, and their
+ * credentials are read once with SO_PEERCRED. Client sockets are
+ * edge-triggered: on_readable must read until recv() fails with EAGAIN, or
+ * it won't be called again until more data arrives.
+ *
+ * All callbacks run on the thread calling socket_server_poll().
+ */
+struct socket_server;
+
+struct socket_server_client {
+    int fd;
+    /* The client's credentials when it connected. */
+    pid_t pid;
+    uid_t uid;
+    gid_t gid;
+    /* For the callbacks' use; starts as NULL. */
+    void* data;
+};
+
+struct socket_server_callbacks {
+    /* Called for each new client; return false to close it. May be NULL. */
+    bool (*on_connect)(struct socket_server_client* client, void* cookie);
+    /* Called when the client has data or hung up; return false to close it. */
+    bool (*on_readable)(struct socket_server_client* client, void* cookie);
+    /* Called before a client is closed, for whatever reason. May be NULL. */
+    void (*on_close)(struct socket_server_client* client, void* cookie);
+};
+
+/*
+ * Creates a server for listen_fd, which is made non-blocking but still
+ * belongs to the caller. Returns NULL on error.
+ */
+struct socket_server* socket_server_create(int listen_fd,
+                                           const struct socket_server_callbacks* callbacks,
+                                           void* cookie);
+
+/*
+ * Returns an fd that becomes readable when socket_server_poll() has work,
+ * so that the server can be driven from another event loop.
+ */
+int socket_server_get_fd(const struct socket_server* server);
+
+/*
+ * Waits up to timeout_ms milliseconds (-1 for ever) for events and handles
+ * them. Returns the number of events handled, or -1 on error.
+ */
+int socket_server_poll(struct socket_server* server, int timeout_ms);
+
+/*
+ * Closes a client outside of its own callbacks, e.g. one found idle. May be
+ * called from any callback for any client.
+ */
+void socket_server_close_client(struct socket_server* server,
+                                struct socket_server_client* client);
+
+/*
+ * Closes every client and frees the server. The listening socket is left
+ * open.
+ */
+void socket_server_destroy(struct socket_server* server);
+
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -17,6 +17,7 @@
 #ifndef __CUTILS_STR_PARMS_H
 #define __CUTILS_STR_PARMS_H
 
+#include <stddef.h>
 #include <stdint.h>
 #include <sys/cdefs.h>
 
@@ -26,6 +27,12 @@ struct str_parms;
 
 struct str_parms *str_parms_create(void);
 struct str_parms *str_parms_create_str(const char *_string);
+
+// Like str_parms_create_str(), but parses into a single allocation: one copy of
+// the input that keys and values point into, plus an array of pairs sorted by
+// key for lookups. Keys added later are copied as usual. The result works with
+// every other str_parms function; str_parms_to_str() lists it in key order.
+struct str_parms *str_parms_create_str_arena(const char *_string);
 void str_parms_destroy(struct str_parms *str_parms);
 
 void str_parms_del(struct str_parms *str_parms, const char *key);
@@ -52,6 +59,11 @@ int str_parms_get_float(struct str_parms *str_parms, const char *key,
 
 char *str_parms_to_str(struct str_parms *str_parms);
 
+// Writes the same string as str_parms_to_str() into the caller's buffer, truncated
+// to fit and always NUL-terminated if len > 0. Returns the length of the full
+// string, so a result >= len means the buffer was too small.
+size_t str_parms_to_str_buf(struct str_parms *str_parms, char *buf, size_t len);
+
 /* debug */
 void str_parms_dump(struct str_parms *str_parms);
 
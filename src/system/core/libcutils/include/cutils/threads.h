@@ -72,6 +72,52 @@ extern void   thread_store_set(thread_store_t*          store,
 
 #ifdef __cplusplus
 }
+
+#include <memory>
+
+namespace android {
+
+//
+// A typed, owning thread_store_t: each thread's value is deleted when the
+// thread exits (except on Windows, where thread_store_t can't do that) or
+// when the thread replaces it. Like thread_store_t, it's meant to have static
+// storage duration; its key is never deleted.
+//
+
+template <typename T>
+class ThreadStore {
+  public:
+    constexpr ThreadStore() = default;
+    ThreadStore(const ThreadStore&) = delete;
+    ThreadStore& operator=(const ThreadStore&) = delete;
+
+    // Returns the calling thread's value, or nullptr if it has none.
+    T* get() { return static_cast<T*>(thread_store_get(&store_)); }
+
+    // Replaces the calling thread's value, deleting any previous one.
+    void set(std::unique_ptr<T> value) {
+        T* old = get();
+        thread_store_set(&store_, value.release(), Destroy);
+        delete old;
+    }
+
+    // Returns the calling thread's value, creating it first if needed.
+    T& get_or_create() {
+        T* value = get();
+        if (value == nullptr) {
+            value = new T();
+            thread_store_set(&store_, value, Destroy);
+        }
+        return *value;
+    }
+
+  private:
+    static void Destroy(void* value) { delete static_cast<T*>(value); }
+
+    thread_store_t store_ = THREAD_STORE_INITIALIZER;
+};
+
+}  // namespace android
 #endif
 
 #endif /* _LIBS_CUTILS_THREADS_H */
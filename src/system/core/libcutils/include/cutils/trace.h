@@ -116,6 +116,41 @@ void atrace_set_debuggable(bool debuggable);
  */
 void atrace_set_tracing_enabled(bool enabled);
 
+/**
+ * Send this process's trace events to fd instead of the kernel trace buffer.
+ * Each thread appends events to its own ring buffer without taking any lock,
+ * and a background thread writes the rings out in batches with writev(), so
+ * most events cost no system call. Pass -1 to go back to writing each event
+ * to the kernel trace buffer directly.
+ *
+ * Since events reach fd after they happen and are written from another
+ * thread, each is written as "ph|pid|tid|timestamp|thread_time|name[|value]"
+ * with the tid and CLOCK_MONOTONIC/CLOCK_THREAD_CPUTIME_ID times (in
+ * microseconds) captured when it was traced, one event per line. Events from
+ * one thread stay in order; events from different threads are only ordered
+ * by their timestamps.
+ *
+ * Returns 0 on success or a negative errno value.
+ */
+int atrace_set_buffered_fd(int fd);
+
+/**
+ * Like atrace_set_buffered_fd(), but write events to fd in a compact binary
+ * format instead of text. Event names are interned per thread and numbers
+ * are varint encoded, so a counter update typically takes a few bytes and
+ * no formatting. The atrace_decode host tool converts the output to
+ * systrace text.
+ *
+ * Returns 0 on success or a negative errno value.
+ */
+int atrace_set_binary_fd(int fd);
+
+/**
+ * Write out every event buffered by atrace_set_buffered_fd() or
+ * atrace_set_binary_fd() so far.
+ */
+void atrace_flush();
+
 /**
  * This is always set to false. This forces code that uses an old version
  * of this header to always call into atrace_setup, in which we call
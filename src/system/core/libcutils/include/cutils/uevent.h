@@ -18,6 +18,7 @@
 #define __CUTILS_UEVENT_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <sys/socket.h>
 
 #ifdef __cplusplus
@@ -29,6 +30,66 @@ ssize_t uevent_kernel_multicast_recv(int socket, void *buffer, size_t length);
 ssize_t uevent_kernel_multicast_uid_recv(int socket, void *buffer, size_t length, uid_t *uid);
 ssize_t uevent_kernel_recv(int socket, void *buffer, size_t length, bool require_group, uid_t *uid);
 
+/* The most messages uevent_kernel_recv_batch() receives in one call. */
+#define UEVENT_BATCH_MAX 64
+
+/* One message for uevent_kernel_recv_batch(). */
+struct uevent_msg {
+    void *buffer;           /* in: where to receive the message */
+    size_t length;          /* in: the size of buffer */
+    ssize_t received;       /* out: the message's length, or -1 if it was rejected */
+    uid_t uid;              /* out: the sender's uid, or -1 if unknown */
+};
+
+/*
+ * Receives up to count (at most UEVENT_BATCH_MAX) messages with a single
+ * recvmmsg(), waiting only for the first. Each message is checked as
+ * uevent_kernel_recv() checks it; a rejected one has its buffer cleared and
+ * received set to -1, but still counts.
+ *
+ * Returns the number of messages filled in, or what recvmmsg() returned if it
+ * failed or the socket was shut down.
+ */
+int uevent_kernel_recv_batch(int socket, struct uevent_msg *msgs, size_t count,
+                             bool require_group);
+
+/* A string in a uevent message. It is not NUL terminated. */
+struct uevent_str {
+    const char *data;
+    size_t len;
+};
+
+/*
+ * Steps through the KEY=value fields of a uevent message of length len,
+ * skipping the leading "action@devpath" line. *pos starts at 0. Returns false
+ * once there are no more fields. key and value point into msg.
+ */
+bool uevent_next_field(const char *msg, size_t len, size_t *pos, struct uevent_str *key,
+                       struct uevent_str *value);
+
+/* The fields of a uevent most consumers look at. Missing ones are empty. */
+struct uevent_fields {
+    struct uevent_str action;
+    struct uevent_str devpath;
+    struct uevent_str subsystem;
+    struct uevent_str devname;
+    struct uevent_str devtype;
+    struct uevent_str driver;
+    struct uevent_str firmware;
+    struct uevent_str modalias;
+    struct uevent_str partname;
+    int major;              /* -1 if missing */
+    int minor;              /* -1 if missing */
+    int partn;              /* -1 if missing */
+    long long seqnum;       /* -1 if missing */
+};
+
+/*
+ * Fills in fields from a uevent message of length len, without copying: the
+ * strings point into msg, so they are valid only as long as it is.
+ */
+void uevent_parse(const char *msg, size_t len, struct uevent_fields *fields);
+
 #ifdef __cplusplus
 }
 #endif
@@ -21,7 +21,20 @@
 
 __BEGIN_DECLS
 
+/*
+ * Loads the canned fs_config in fn, replacing any loaded before. fn may be
+ * the text form, one "path uid gid mode [capabilities=N]" line per file, or
+ * the binary form written by compile_canned_fs_config(), which is mapped
+ * rather than parsed. Returns 0 on success and -1 on failure.
+ */
 int load_canned_fs_config(const char* fn);
+
+/*
+ * Converts the text canned fs_config in text_fn to the binary form, written
+ * to binary_fn. Returns 0 on success and -1 on failure.
+ */
+int compile_canned_fs_config(const char* text_fn, const char* binary_fn);
+
 void canned_fs_config(const char* path, int dir, const char* target_out_path, unsigned* uid,
                       unsigned* gid, unsigned* mode, uint64_t* capabilities);
 
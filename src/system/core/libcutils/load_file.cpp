@@ -17,37 +17,146 @@
 
 #include <cutils/misc.h>
 
+#include <errno.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <sys/stat.h>
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#endif
 
-void *load_file(const char *fn, unsigned *_sz)
+#if defined(_WIN32)
+#define O_CLOEXEC 0
+#endif
+
+// Reads fd to end of file into a malloc'd, null-terminated buffer. size_hint
+// is the expected size, or 0 if unknown.
+static char* read_fd(int fd, size_t size_hint, size_t* size)
 {
-    char *data;
-    int sz;
-    int fd;
+    // Leave room for the terminator, and for the read that finds end of file,
+    // so a file of exactly size_hint bytes needs no reallocation.
+    size_t capacity = size_hint > 0 ? size_hint + 2 : 4096;
+    size_t len = 0;
+    char* data = static_cast<char*>(malloc(capacity));
+    if (data == nullptr) return nullptr;
 
-    data = 0;
-    fd = open(fn, O_RDONLY);
-    if(fd < 0) return 0;
+    for (;;) {
+        if (len + 1 == capacity) {
+            char* bigger = static_cast<char*>(realloc(data, capacity * 2));
+            if (bigger == nullptr) goto oops;
+            data = bigger;
+            capacity *= 2;
+        }
+        ssize_t n = read(fd, data + len, capacity - 1 - len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            goto oops;
+        }
+        if (n == 0) break;
+        len += n;
+    }
 
-    sz = lseek(fd, 0, SEEK_END);
-    if(sz < 0) goto oops;
+    data[len] = 0;
+    *size = len;
+    return data;
 
-    if(lseek(fd, 0, SEEK_SET) != 0) goto oops;
+oops:
+    int saved_errno = errno;
+    free(data);
+    errno = saved_errno;
+    return nullptr;
+}
 
-    data = (char*) malloc(sz + 1);
-    if(data == 0) goto oops;
+void *load_file(const char *fn, unsigned *_sz)
+{
+    int fd = open(fn, O_RDONLY);
+    if(fd < 0) return 0;
 
-    if(read(fd, data, sz) != sz) goto oops;
+    struct stat st;
+    size_t size_hint = (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) ? st.st_size : 0;
+    size_t sz;
+    char* data = read_fd(fd, size_hint, &sz);
     close(fd);
-    data[sz] = 0;
 
-    if(_sz) *_sz = sz;
+    if(data != 0 && _sz) *_sz = sz;
     return data;
+}
 
-oops:
+#if !defined(_WIN32)
+// Maps size bytes of fd followed by at least one zero byte. The file is
+// mapped over the start of an anonymous reservation, so the terminator is
+// there even when size is a whole number of pages.
+static char* map_fd(int fd, size_t size, int flags, size_t* mapped_size)
+{
+    size_t page_size = getpagesize();
+    size_t reserve = (size + page_size) & ~(page_size - 1);
+
+    int prot = PROT_READ | ((flags & LOAD_FILE_WRITABLE) ? PROT_WRITE : 0);
+    void* base = mmap(nullptr, reserve, prot, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) return nullptr;
+    if (mmap(base, size, prot, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        int saved_errno = errno;
+        munmap(base, reserve);
+        errno = saved_errno;
+        return nullptr;
+    }
+
+    // Callers load files to parse them from front to back.
+    madvise(base, size, MADV_SEQUENTIAL);
+    madvise(base, size, MADV_WILLNEED);
+
+    *mapped_size = reserve;
+    return static_cast<char*>(base);
+}
+#endif
+
+int load_file_mapped(const char *fn, struct mapped_file *file, int flags)
+{
+    int fd = open(fn, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        int saved_errno = errno;
+        close(fd);
+        errno = saved_errno;
+        return -1;
+    }
+
+    file->mapped_size = 0;
+    file->data = nullptr;
+#if !defined(_WIN32)
+    // An empty file can't be mapped, but also costs nothing to read.
+    if (S_ISREG(st.st_mode) && st.st_size > 0) {
+        file->data = map_fd(fd, st.st_size, flags, &file->mapped_size);
+        file->size = st.st_size;
+    }
+#endif
+    // Not a regular file (or the mapping failed): its size, if any, is only
+    // a hint, so read until end of file.
+    if (file->data == nullptr) {
+        file->data = read_fd(fd, S_ISREG(st.st_mode) ? st.st_size : 0, &file->size);
+    }
+
+    int saved_errno = errno;
     close(fd);
-    if(data != 0) free(data);
-    return 0;
+    errno = saved_errno;
+    return file->data != nullptr ? 0 : -1;
+}
+
+void unload_file_mapped(struct mapped_file *file)
+{
+#if !defined(_WIN32)
+    if (file->mapped_size != 0) {
+        munmap(file->data, file->mapped_size);
+    } else {
+        free(file->data);
+    }
+#else
+    free(file->data);
+#endif
+    file->data = nullptr;
+    file->size = 0;
+    file->mapped_size = 0;
 }
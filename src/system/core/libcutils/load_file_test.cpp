@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cutils/misc.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <string>
+
+#include <android-base/file.h>
+#include <cutils/config_utils.h>
+#include <gtest/gtest.h>
+
+static void ExpectMapped(const std::string& path, const std::string& contents, int flags) {
+    mapped_file file;
+    ASSERT_EQ(0, load_file_mapped(path.c_str(), &file, flags));
+    EXPECT_NE(0u, file.mapped_size);
+    ASSERT_EQ(contents.size(), file.size);
+    EXPECT_EQ(contents, std::string(file.data, file.size));
+    EXPECT_EQ('\0', file.data[file.size]);
+    unload_file_mapped(&file);
+    EXPECT_EQ(nullptr, file.data);
+}
+
+TEST(LoadFileTest, mapped) {
+    TemporaryFile tf;
+    std::string contents = "hello, world\n";
+    ASSERT_TRUE(android::base::WriteStringToFile(contents, tf.path));
+    ExpectMapped(tf.path, contents, 0);
+}
+
+TEST(LoadFileTest, mapped_whole_pages) {
+    // The terminator must come from past the end of the file's last page.
+    TemporaryFile tf;
+    std::string contents(2 * getpagesize(), 'x');
+    ASSERT_TRUE(android::base::WriteStringToFile(contents, tf.path));
+    ExpectMapped(tf.path, contents, 0);
+}
+
+TEST(LoadFileTest, mapped_writable) {
+    TemporaryFile tf;
+    ASSERT_TRUE(android::base::WriteStringToFile("abc", tf.path));
+
+    mapped_file file;
+    ASSERT_EQ(0, load_file_mapped(tf.path, &file, LOAD_FILE_WRITABLE));
+    file.data[0] = 'x';
+    unload_file_mapped(&file);
+
+    std::string contents;
+    ASSERT_TRUE(android::base::ReadFileToString(tf.path, &contents));
+    EXPECT_EQ("abc", contents);
+}
+
+TEST(LoadFileTest, empty) {
+    TemporaryFile tf;
+    mapped_file file;
+    ASSERT_EQ(0, load_file_mapped(tf.path, &file, 0));
+    EXPECT_EQ(0u, file.size);
+    EXPECT_EQ(0u, file.mapped_size);
+    EXPECT_EQ('\0', file.data[0]);
+    unload_file_mapped(&file);
+}
+
+#if defined(__linux__)
+TEST(LoadFileTest, proc) {
+    // /proc files report a size of 0, so must be read to end of file.
+    std::string expected;
+    ASSERT_TRUE(android::base::ReadFileToString("/proc/self/status", &expected));
+    ASSERT_NE(0u, expected.size());
+
+    mapped_file file;
+    ASSERT_EQ(0, load_file_mapped("/proc/self/status", &file, 0));
+    EXPECT_EQ(0u, file.mapped_size);
+    EXPECT_EQ(expected.substr(0, 5), std::string(file.data, 5));
+    EXPECT_EQ(strlen(file.data), file.size);
+    unload_file_mapped(&file);
+
+    unsigned size;
+    char* data = static_cast<char*>(load_file("/proc/self/status", &size));
+    ASSERT_NE(nullptr, data);
+    EXPECT_EQ(strlen(data), size);
+    free(data);
+}
+#endif
+
+TEST(LoadFileTest, missing) {
+    mapped_file file;
+    errno = 0;
+    EXPECT_EQ(-1, load_file_mapped("/does/not/exist", &file, 0));
+    EXPECT_EQ(ENOENT, errno);
+    EXPECT_EQ(nullptr, load_file("/does/not/exist", nullptr));
+}
+
+TEST(LoadFileTest, config_load_file) {
+    TemporaryFile tf;
+    ASSERT_TRUE(android::base::WriteStringToFile("a 1\nb {\n  c two words \n}\n", tf.path));
+
+    cnode* root = config_node("", "");
+    config_load_file(root, tf.path);
+    EXPECT_STREQ("1", config_str(root, "a", ""));
+    cnode* b = config_find(root, "b");
+    ASSERT_NE(nullptr, b);
+    EXPECT_STREQ("two words", config_str(b, "c", ""));
+    config_free(root);
+    free(root);
+
+    // Parsing terminated names and values in the mapping, not the file.
+    std::string contents;
+    ASSERT_TRUE(android::base::ReadFileToString(tf.path, &contents));
+    EXPECT_EQ("a 1\nb {\n  c two words \n}\n", contents);
+}
@@ -21,6 +21,85 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#if !defined(_WIN32)
+#include <pthread.h>
+#endif
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+
+#include <algorithm>
+
+/*
+ * Freed handles with up to CACHED_HANDLE_MAX_INTS fds and ints are kept in a
+ * per-thread cache, CACHED_HANDLES_PER_SIZE of each size, for the next
+ * native_handle_create() of that size. Cached handles are ordinary malloc'd
+ * blocks, exactly as native_handle_create() allocates them, so a handle can
+ * still be freed with free(), and any malloc'd handle can be deleted.
+ */
+#define CACHED_HANDLE_MAX_INTS 64
+#define CACHED_HANDLES_PER_SIZE 16
+
+#if !defined(_WIN32)
+struct handle_cache {
+    bool registered;  /* whether handle_cache_key will drain this cache */
+    bool exited;      /* the thread is exiting; stop caching */
+    uint8_t count[CACHED_HANDLE_MAX_INTS + 1];
+    void* first[CACHED_HANDLE_MAX_INTS + 1];  /* linked through each block's first word */
+};
+
+static thread_local handle_cache tls_handle_cache;
+static pthread_key_t handle_cache_key;
+static pthread_once_t handle_cache_once = PTHREAD_ONCE_INIT;
+
+static void handle_cache_drain(void* arg) {
+    handle_cache* cache = static_cast<handle_cache*>(arg);
+    cache->exited = true;
+    for (int n = 0; n <= CACHED_HANDLE_MAX_INTS; n++) {
+        while (cache->first[n]) {
+            void* block = cache->first[n];
+            memcpy(&cache->first[n], block, sizeof(void*));
+            free(block);
+        }
+        cache->count[n] = 0;
+    }
+}
+
+static void handle_cache_init() {
+    pthread_key_create(&handle_cache_key, handle_cache_drain);
+}
+
+static native_handle_t* handle_cache_get(int numInts) {
+    handle_cache* cache = &tls_handle_cache;
+    void* block = cache->first[numInts];
+    if (!block) return NULL;
+    memcpy(&cache->first[numInts], block, sizeof(void*));
+    cache->count[numInts]--;
+    return static_cast<native_handle_t*>(block);
+}
+
+static bool handle_cache_put(native_handle_t* h, int numInts) {
+    handle_cache* cache = &tls_handle_cache;
+    if (cache->exited || cache->count[numInts] == CACHED_HANDLES_PER_SIZE) return false;
+    if (!cache->registered) {
+        pthread_once(&handle_cache_once, handle_cache_init);
+        if (pthread_setspecific(handle_cache_key, cache) != 0) return false;
+        cache->registered = true;
+    }
+    memcpy(h, &cache->first[numInts], sizeof(void*));
+    cache->first[numInts] = h;
+    cache->count[numInts]++;
+    return true;
+}
+#else
+static native_handle_t* handle_cache_get(int) {
+    return NULL;
+}
+
+static bool handle_cache_put(native_handle_t*, int) {
+    return false;
+}
+#endif
 
 native_handle_t* native_handle_init(char* storage, int numFds, int numInts) {
     if ((uintptr_t) storage % alignof(native_handle_t)) {
@@ -42,8 +121,14 @@ native_handle_t* native_handle_create(int numFds, int numInts) {
         return NULL;
     }
 
-    size_t mallocSize = sizeof(native_handle_t) + (sizeof(int) * (numFds + numInts));
-    native_handle_t* h = static_cast<native_handle_t*>(malloc(mallocSize));
+    native_handle_t* h = NULL;
+    if (numFds + numInts <= CACHED_HANDLE_MAX_INTS) {
+        h = handle_cache_get(numFds + numInts);
+    }
+    if (!h) {
+        size_t mallocSize = sizeof(native_handle_t) + (sizeof(int) * (numFds + numInts));
+        h = static_cast<native_handle_t*>(malloc(mallocSize));
+    }
     if (h) {
         h->version = sizeof(native_handle_t);
         h->numFds = numFds;
@@ -75,7 +160,10 @@ native_handle_t* native_handle_clone(const native_handle_t* handle) {
 int native_handle_delete(native_handle_t* h) {
     if (h) {
         if (h->version != sizeof(native_handle_t)) return -EINVAL;
-        free(h);
+        int numInts = h->numFds + h->numInts;
+        if (numInts < 0 || numInts > CACHED_HANDLE_MAX_INTS || !handle_cache_put(h, numInts)) {
+            free(h);
+        }
     }
     return 0;
 }
@@ -93,3 +181,79 @@ int native_handle_close(const native_handle_t* h) {
     errno = saved_errno;
     return 0;
 }
+
+// Closes fds, which must be sorted, with one close_range() per consecutive run.
+static void close_sorted_fds(const int* fds, size_t count) {
+    // Unused slots are sometimes -1; there's nothing to close for them.
+    while (count > 0 && fds[0] < 0) {
+        fds++;
+        count--;
+    }
+#if defined(__linux__) && defined(__NR_close_range)
+    static bool close_range_supported = true;
+    if (close_range_supported) {
+        size_t i = 0;
+        while (i < count) {
+            size_t j = i + 1;
+            while (j < count && fds[j] <= fds[j - 1] + 1) j++;
+            if (j - i == 1) {
+                close(fds[i]);
+            } else if (syscall(__NR_close_range, fds[i], fds[j - 1], 0) != 0) {
+                close_range_supported = false;
+                break;
+            }
+            i = j;
+        }
+        if (i == count) return;
+        fds += i;
+        count -= i;
+    }
+#endif
+    for (size_t i = 0; i < count; i++) close(fds[i]);
+}
+
+int native_handle_close_batch(const native_handle_t* const* handles, size_t count) {
+    size_t numFds = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (!handles[i]) continue;
+        if (handles[i]->version != sizeof(native_handle_t)) return -EINVAL;
+        numFds += handles[i]->numFds;
+    }
+
+    int saved_errno = errno;
+    int stack_fds[256];
+    int* fds = numFds <= 256 ? stack_fds : static_cast<int*>(malloc(numFds * sizeof(int)));
+    if (fds) {
+        size_t n = 0;
+        for (size_t i = 0; i < count; i++) {
+            if (!handles[i]) continue;
+            memcpy(&fds[n], handles[i]->data, handles[i]->numFds * sizeof(int));
+            n += handles[i]->numFds;
+        }
+        std::sort(fds, fds + n);
+        close_sorted_fds(fds, n);
+        if (fds != stack_fds) free(fds);
+    } else {
+        for (size_t i = 0; i < count; i++) native_handle_close(handles[i]);
+    }
+    errno = saved_errno;
+    return 0;
+}
+
+int native_handle_clone_batch(const native_handle_t* const* handles, size_t count,
+                              native_handle_t** clones) {
+    for (size_t i = 0; i < count; i++) {
+        clones[i] = native_handle_clone(handles[i]);
+        if (clones[i] == NULL) {
+            int saved_errno = errno;
+            native_handle_close_batch(clones, i);
+            for (size_t j = 0; j < i; j++) {
+                native_handle_delete(clones[j]);
+                clones[j] = NULL;
+            }
+            errno = saved_errno;
+            return -1;
+        }
+    }
+    return 0;
+}
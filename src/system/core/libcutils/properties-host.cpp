@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "properties-host.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <cutils/properties.h>
+
+// Like bionic's, a prop_info is never freed once a property exists, so
+// callers may keep pointers to it; only its value and serial change.
+struct prop_info {
+    explicit prop_info(const std::string& name) : name(name) {}
+
+    const std::string name;
+    std::string value;  // Guarded by g_lock.
+    std::atomic<uint32_t> serial{0};
+};
+
+static std::mutex g_lock;
+static std::atomic<uint32_t> g_area_serial{0};
+
+static std::map<std::string, prop_info*>& properties() {
+    static auto& properties = *new std::map<std::string, prop_info*>;
+    return properties;
+}
+
+int __system_property_set(const char* key, const char* value) {
+    if (key == nullptr) return -1;
+    if (value == nullptr) value = "";
+
+    bool read_only = strncmp(key, "ro.", 3) == 0;
+    if (!read_only && strlen(value) >= PROP_VALUE_MAX) return -1;
+
+    std::lock_guard<std::mutex> lock(g_lock);
+    auto it = properties().find(key);
+    if (it == properties().end()) {
+        prop_info* pi = new prop_info(key);
+        pi->value = value;
+        properties().emplace(key, pi);
+        g_area_serial.fetch_add(1, std::memory_order_release);
+        return 0;
+    }
+    if (read_only) return -1;
+
+    prop_info* pi = it->second;
+    pi->value = value;
+    pi->serial.fetch_add(1, std::memory_order_release);
+    return 0;
+}
+
+int __system_property_get(const char* name, char* value) {
+    std::lock_guard<std::mutex> lock(g_lock);
+    auto it = properties().find(name);
+    if (it == properties().end()) {
+        value[0] = '\0';
+        return 0;
+    }
+    size_t len = std::min(it->second->value.size(), static_cast<size_t>(PROP_VALUE_MAX - 1));
+    memcpy(value, it->second->value.data(), len);
+    value[len] = '\0';
+    return len;
+}
+
+const prop_info* __system_property_find(const char* name) {
+    std::lock_guard<std::mutex> lock(g_lock);
+    auto it = properties().find(name);
+    return it == properties().end() ? nullptr : it->second;
+}
+
+uint32_t __system_property_serial(const prop_info* pi) {
+    return pi->serial.load(std::memory_order_acquire);
+}
+
+uint32_t __system_property_area_serial() {
+    return g_area_serial.load(std::memory_order_acquire);
+}
+
+void __system_property_read_callback(const prop_info* pi,
+                                     void (*callback)(void* cookie, const char* name,
+                                                      const char* value, uint32_t serial),
+                                     void* cookie) {
+    std::string value;
+    uint32_t serial;
+    {
+        std::lock_guard<std::mutex> lock(g_lock);
+        value = pi->value;
+        serial = pi->serial.load(std::memory_order_relaxed);
+    }
+    callback(cookie, pi->name.c_str(), value.c_str(), serial);
+}
+
+int __system_property_foreach(void (*propfn)(const prop_info* pi, void* cookie), void* cookie) {
+    std::vector<const prop_info*> infos;
+    {
+        std::lock_guard<std::mutex> lock(g_lock);
+        for (const auto& entry : properties()) infos.push_back(entry.second);
+    }
+    for (const prop_info* pi : infos) propfn(pi, cookie);
+    return 0;
+}
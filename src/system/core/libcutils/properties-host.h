@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef __PROPERTIES_HOST_H
+#define __PROPERTIES_HOST_H
+
+/*
+ * The subset of bionic's system property API that properties.cpp uses,
+ * implemented for host builds by properties-host.cpp. Properties live in
+ * the calling process only, which is enough for host tools and for running
+ * the libcutils tests and benchmarks on the host.
+ */
+
+#include <stdint.h>
+
+typedef struct prop_info prop_info;
+
+extern "C" {
+
+int __system_property_set(const char* key, const char* value);
+int __system_property_get(const char* name, char* value);
+const prop_info* __system_property_find(const char* name);
+uint32_t __system_property_serial(const prop_info* pi);
+uint32_t __system_property_area_serial();
+void __system_property_read_callback(const prop_info* pi,
+                                     void (*callback)(void* cookie, const char* name,
+                                                      const char* value, uint32_t serial),
+                                     void* cookie);
+int __system_property_foreach(void (*propfn)(const prop_info* pi, void* cookie), void* cookie);
+
+}  // extern "C"
+
+#endif  // __PROPERTIES_HOST_H
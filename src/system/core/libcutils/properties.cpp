@@ -30,6 +30,36 @@
 #include <cutils/sockets.h>
 #include <log/log.h>
 
+#if defined(__BIONIC__)
+#define _REALLY_INCLUDE_SYS__SYSTEM_PROPERTIES_H_
+#include <sys/_system_properties.h>
+#else
+#include "properties-host.h"
+#endif
+
+// Parses value as a boolean; returns false if it is neither true nor false.
+static bool parse_bool(const char* value, int len, int8_t* result) {
+    if (len == 1) {
+        char ch = value[0];
+        if (ch == '0' || ch == 'n') {
+            *result = false;
+            return true;
+        } else if (ch == '1' || ch == 'y') {
+            *result = true;
+            return true;
+        }
+    } else if (len > 1) {
+        if (!strcmp(value, "no") || !strcmp(value, "false") || !strcmp(value, "off")) {
+            *result = false;
+            return true;
+        } else if (!strcmp(value, "yes") || !strcmp(value, "true") || !strcmp(value, "on")) {
+            *result = true;
+            return true;
+        }
+    }
+    return false;
+}
+
 int8_t property_get_bool(const char *key, int8_t default_value) {
     if (!key) {
         return default_value;
@@ -39,24 +69,43 @@ int8_t property_get_bool(const char *key, int8_t default_value) {
     char buf[PROPERTY_VALUE_MAX] = {'\0'};
 
     int len = property_get(key, buf, "");
-    if (len == 1) {
-        char ch = buf[0];
-        if (ch == '0' || ch == 'n') {
-            result = false;
-        } else if (ch == '1' || ch == 'y') {
-            result = true;
-        }
-    } else if (len > 1) {
-        if (!strcmp(buf, "no") || !strcmp(buf, "false") || !strcmp(buf, "off")) {
-            result = false;
-        } else if (!strcmp(buf, "yes") || !strcmp(buf, "true") || !strcmp(buf, "on")) {
-            result = true;
-        }
-    }
+    parse_bool(buf, len, &result);
 
     return result;
 }
 
+// Parses value as an integer within bounds; returns false if it isn't one.
+static bool parse_imax(const char* key, const char* value, intmax_t lower_bound,
+                       intmax_t upper_bound, intmax_t* result) {
+    if (value[0] == '\0') {
+        return false;
+    }
+
+    int tmp = errno;
+    errno = 0;
+    char *end = NULL;
+    bool ok = false;
+
+    // Infer base automatically
+    intmax_t parsed = strtoimax(value, &end, /*base*/ 0);
+    if ((parsed == INTMAX_MIN || parsed == INTMAX_MAX) && errno == ERANGE) {
+        // Over or underflow
+        ALOGV("%s(%s) - overflow", __FUNCTION__, key);
+    } else if (parsed < lower_bound || parsed > upper_bound) {
+        // Out of range of requested bounds
+        ALOGV("%s(%s) - out of range", __FUNCTION__, key);
+    } else if (end == value) {
+        // Numeric conversion failed
+        ALOGV("%s(%s) - numeric conversion failed", __FUNCTION__, key);
+    } else {
+        *result = parsed;
+        ok = true;
+    }
+
+    errno = tmp;
+    return ok;
+}
+
 // Convert string property to int (default if fails); return default value if out of bounds
 static intmax_t property_get_imax(const char *key, intmax_t lower_bound, intmax_t upper_bound,
                                   intmax_t default_value) {
@@ -66,32 +115,9 @@ static intmax_t property_get_imax(const char *key, intmax_t lower_bound, intmax_
 
     intmax_t result = default_value;
     char buf[PROPERTY_VALUE_MAX] = {'\0'};
-    char *end = NULL;
 
-    int len = property_get(key, buf, "");
-    if (len > 0) {
-        int tmp = errno;
-        errno = 0;
-
-        // Infer base automatically
-        result = strtoimax(buf, &end, /*base*/ 0);
-        if ((result == INTMAX_MIN || result == INTMAX_MAX) && errno == ERANGE) {
-            // Over or underflow
-            result = default_value;
-            ALOGV("%s(%s,%" PRIdMAX ") - overflow", __FUNCTION__, key, default_value);
-        } else if (result < lower_bound || result > upper_bound) {
-            // Out of range of requested bounds
-            result = default_value;
-            ALOGV("%s(%s,%" PRIdMAX ") - out of range", __FUNCTION__, key, default_value);
-        } else if (end == buf) {
-            // Numeric conversion failed
-            result = default_value;
-            ALOGV("%s(%s,%" PRIdMAX ") - numeric conversion failed", __FUNCTION__, key,
-                  default_value);
-        }
-
-        errno = tmp;
-    }
+    property_get(key, buf, "");
+    parse_imax(key, buf, lower_bound, upper_bound, &result);
 
     return result;
 }
@@ -104,8 +130,92 @@ int32_t property_get_int32(const char *key, int32_t default_value) {
     return (int32_t)property_get_imax(key, INT32_MIN, INT32_MAX, default_value);
 }
 
-#define _REALLY_INCLUDE_SYS__SYSTEM_PROPERTIES_H_
-#include <sys/_system_properties.h>
+enum cached_property_type : int8_t {
+    CACHED_PROPERTY_BOOL = 1,
+    CACHED_PROPERTY_INT32,
+    CACHED_PROPERTY_INT64,
+};
+
+void cached_property_init(struct cached_property* prop, const char* key) {
+    cached_property init = CACHED_PROPERTY_INIT(key);
+    *prop = init;
+}
+
+static void cached_property_parse(void* cookie, const char* /*name*/, const char* value,
+                                  uint32_t serial) {
+    cached_property* prop = reinterpret_cast<cached_property*>(cookie);
+    // property_get() can't read values this long (only read-only properties
+    // have them), so neither can the property_get_*() functions.
+    size_t len = strlen(value);
+    bool ok = false;
+    if (len < PROPERTY_VALUE_MAX) {
+        if (prop->type == CACHED_PROPERTY_BOOL) {
+            int8_t result = 0;
+            ok = parse_bool(value, len, &result);
+            prop->value = result;
+        } else {
+            intmax_t result = 0;
+            if (prop->type == CACHED_PROPERTY_INT32) {
+                ok = parse_imax(prop->key, value, INT32_MIN, INT32_MAX, &result);
+            } else {
+                ok = parse_imax(prop->key, value, INT64_MIN, INT64_MAX, &result);
+            }
+            prop->value = result;
+        }
+    }
+    prop->valid = ok;
+    prop->serial = serial;
+}
+
+// Returns the cached value of prop, parsed as type, re-reading it only if the
+// property has changed since it was last parsed.
+static bool cached_property_get(cached_property* prop, int8_t type, int64_t* value) {
+    if (!prop->key) {
+        return false;
+    }
+
+    const prop_info* pi = static_cast<const prop_info*>(prop->info);
+    if (!pi) {
+        // Only look the key up again if a property has been added since.
+        uint32_t area_serial = __system_property_area_serial();
+        if (prop->type == type && prop->serial == area_serial) {
+            return false;
+        }
+        pi = __system_property_find(prop->key);
+        if (!pi) {
+            prop->type = type;
+            prop->serial = area_serial;
+            prop->valid = false;
+            return false;
+        }
+        prop->info = pi;
+    } else if (prop->type == type && prop->serial == __system_property_serial(pi)) {
+        *value = prop->value;
+        return prop->valid;
+    }
+
+    prop->type = type;
+    __system_property_read_callback(pi, cached_property_parse, prop);
+    *value = prop->value;
+    return prop->valid;
+}
+
+int8_t cached_property_get_bool(struct cached_property* prop, int8_t default_value) {
+    int64_t value;
+    return cached_property_get(prop, CACHED_PROPERTY_BOOL, &value) ? (int8_t)value
+                                                                     : default_value;
+}
+
+int64_t cached_property_get_int64(struct cached_property* prop, int64_t default_value) {
+    int64_t value;
+    return cached_property_get(prop, CACHED_PROPERTY_INT64, &value) ? value : default_value;
+}
+
+int32_t cached_property_get_int32(struct cached_property* prop, int32_t default_value) {
+    int64_t value;
+    return cached_property_get(prop, CACHED_PROPERTY_INT32, &value) ? (int32_t)value
+                                                                      : default_value;
+}
 
 int property_set(const char *key, const char *value) {
     return __system_property_set(key, value);
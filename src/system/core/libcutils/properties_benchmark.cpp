@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cutils/properties.h>
+
+#include <stdio.h>
+
+#include <android-base/logging.h>
+#include <benchmark/benchmark.h>
+
+#define BENCH_INT_KEY "debug.libcutils.bench.int"
+#define BENCH_BOOL_KEY "debug.libcutils.bench.bool"
+#define BENCH_MISSING_KEY "debug.libcutils.bench.missing"
+
+static void SetUp() {
+    static bool done = [] {
+        CHECK_EQ(0, property_set(BENCH_INT_KEY, "0x7fff"));
+        CHECK_EQ(0, property_set(BENCH_BOOL_KEY, "true"));
+        // On the host the property area is otherwise empty; give lookups
+        // something to search through, as they would have on a device.
+        for (int i = 0; i < 500; ++i) {
+            char key[PROPERTY_KEY_MAX];
+            snprintf(key, sizeof(key), "debug.libcutils.bench.fill%d", i);
+            property_set(key, "1");
+        }
+        return true;
+    }();
+    (void)done;
+}
+
+static void BM_property_get_int32(benchmark::State& state) {
+    SetUp();
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(property_get_int32(BENCH_INT_KEY, 0));
+    }
+}
+BENCHMARK(BM_property_get_int32);
+
+static void BM_cached_property_get_int32(benchmark::State& state) {
+    SetUp();
+    cached_property prop = CACHED_PROPERTY_INIT(BENCH_INT_KEY);
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(cached_property_get_int32(&prop, 0));
+    }
+}
+BENCHMARK(BM_cached_property_get_int32);
+
+static void BM_property_get_bool(benchmark::State& state) {
+    SetUp();
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(property_get_bool(BENCH_BOOL_KEY, false));
+    }
+}
+BENCHMARK(BM_property_get_bool);
+
+static void BM_cached_property_get_bool(benchmark::State& state) {
+    SetUp();
+    cached_property prop = CACHED_PROPERTY_INIT(BENCH_BOOL_KEY);
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(cached_property_get_bool(&prop, false));
+    }
+}
+BENCHMARK(BM_cached_property_get_bool);
+
+static void BM_property_get_int64_missing(benchmark::State& state) {
+    SetUp();
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(property_get_int64(BENCH_MISSING_KEY, 0));
+    }
+}
+BENCHMARK(BM_property_get_int64_missing);
+
+static void BM_cached_property_get_int64_missing(benchmark::State& state) {
+    SetUp();
+    cached_property prop = CACHED_PROPERTY_INIT(BENCH_MISSING_KEY);
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(cached_property_get_int64(&prop, 0));
+    }
+}
+BENCHMARK(BM_cached_property_get_int64_missing);
+
+BENCHMARK_MAIN();
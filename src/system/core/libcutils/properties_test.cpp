@@ -357,4 +357,68 @@ TEST_F(PropertiesTest, GetInt32) {
     }
 }
 
+TEST_F(PropertiesTest, CachedMatchesUncached) {
+    const char* values[] = {
+        "1", "true", "y", "yes", "on", "0", "false", "n", "no", "off",
+        "", " ", "garbage", "True", "2", "-2", "0x10", "010", " 123 ", "-",
+        "2147483647", "2147483648", "-2147483648", "-2147483649",
+        "9223372036854775807", "9223372036854775808", "-9223372036854775808",
+    };
+
+    cached_property b = CACHED_PROPERTY_INIT(PROPERTY_TEST_KEY);
+    cached_property i32 = CACHED_PROPERTY_INIT(PROPERTY_TEST_KEY);
+    cached_property i64;
+    cached_property_init(&i64, PROPERTY_TEST_KEY);
+
+    for (size_t i = 0; i < arraysize(values); ++i) {
+        ASSERT_OK(property_set(PROPERTY_TEST_KEY, values[i]));
+        // Twice each, so the second read comes from the cache.
+        for (int pass = 0; pass < 2; ++pass) {
+            EXPECT_EQ(property_get_bool(PROPERTY_TEST_KEY, 7), cached_property_get_bool(&b, 7))
+                    << "'" << values[i] << "'";
+            EXPECT_EQ(property_get_int32(PROPERTY_TEST_KEY, 42),
+                      cached_property_get_int32(&i32, 42)) << "'" << values[i] << "'";
+            EXPECT_EQ(property_get_int64(PROPERTY_TEST_KEY, -42),
+                      cached_property_get_int64(&i64, -42)) << "'" << values[i] << "'";
+        }
+    }
+}
+
+TEST_F(PropertiesTest, CachedDefaultsAreNotCached) {
+    cached_property prop = CACHED_PROPERTY_INIT(PROPERTY_TEST_KEY);
+
+    ASSERT_OK(property_set(PROPERTY_TEST_KEY, "garbage"));
+    EXPECT_EQ(1, cached_property_get_int32(&prop, 1));
+    EXPECT_EQ(2, cached_property_get_int32(&prop, 2));
+
+    ASSERT_OK(property_set(PROPERTY_TEST_KEY, "17"));
+    EXPECT_EQ(17, cached_property_get_int32(&prop, 1));
+    EXPECT_EQ(17, cached_property_get_int32(&prop, 2));
+}
+
+TEST_F(PropertiesTest, CachedTypeChange) {
+    cached_property prop = CACHED_PROPERTY_INIT(PROPERTY_TEST_KEY);
+
+    // Valid as an int64, but out of range for an int32.
+    ASSERT_OK(property_set(PROPERTY_TEST_KEY, "4294967296"));
+    EXPECT_EQ(INT64_C(4294967296), cached_property_get_int64(&prop, 0));
+    EXPECT_EQ(-1, cached_property_get_int32(&prop, -1));
+    EXPECT_EQ(INT64_C(4294967296), cached_property_get_int64(&prop, 0));
+
+    ASSERT_OK(property_set(PROPERTY_TEST_KEY, "1"));
+    EXPECT_EQ(1, cached_property_get_int64(&prop, 0));
+    EXPECT_EQ(1, cached_property_get_bool(&prop, 0));
+}
+
+TEST_F(PropertiesTest, CachedMissingKey) {
+    cached_property null_key = CACHED_PROPERTY_INIT(NULL);
+    EXPECT_EQ(3, cached_property_get_int32(&null_key, 3));
+    EXPECT_EQ(-1, cached_property_get_bool(&null_key, -1));
+
+    cached_property missing = CACHED_PROPERTY_INIT(PROPERTY_TEST_KEY ".never_set");
+    EXPECT_EQ(5, cached_property_get_int64(&missing, 5));
+    EXPECT_EQ(6, cached_property_get_int64(&missing, 6));
+    EXPECT_EQ(-1, cached_property_get_bool(&missing, -1));
+}
+
 } // namespace android
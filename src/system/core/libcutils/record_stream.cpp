@@ -27,19 +27,30 @@
 #include <winsock2.h>   /* for ntohl */
 #else
 #include <netinet/in.h>
+#include <sys/uio.h>
 #endif
 
 #define HEADER_SIZE 4
 
+/* The ring holds at least this many bytes, so one read can fetch many
+ * small records. */
+#define MIN_RING_SIZE 0x4000
+
+/*
+ * Records are read into a ring buffer and handed out where they lie, so
+ * nothing is ever moved to the front. The ring is followed by room for one
+ * more record: when a record wraps around the end of the ring, the part at
+ * the start is copied there so the record is contiguous.
+ */
 struct RecordStream {
     int fd;
     size_t maxRecordLen;
 
     unsigned char *buffer;
+    size_t size;            /* of the ring, not counting the room after it */
 
-    unsigned char *unconsumed;
-    unsigned char *read_end;
-    unsigned char *buffer_end;
+    size_t head;            /* offset of the first unconsumed byte */
+    size_t count;           /* number of unconsumed bytes */
 };
 
 
@@ -53,11 +64,11 @@ extern RecordStream *record_stream_new(int fd, size_t maxRecordLen)
 
     ret->fd = fd;
     ret->maxRecordLen = maxRecordLen;
-    ret->buffer = (unsigned char *)malloc (maxRecordLen + HEADER_SIZE);
-    
-    ret->unconsumed = ret->buffer;
-    ret->read_end = ret->buffer;
-    ret->buffer_end = ret->buffer + maxRecordLen + HEADER_SIZE;
+    ret->size = 4 * (maxRecordLen + HEADER_SIZE);
+    if (ret->size < MIN_RING_SIZE) {
+        ret->size = MIN_RING_SIZE;
+    }
+    ret->buffer = (unsigned char *)malloc (ret->size + maxRecordLen + HEADER_SIZE);
 
     return ret;
 }
@@ -70,51 +81,138 @@ extern void record_stream_free(RecordStream *rs)
 }
 
 
-/* returns NULL; if there isn't a full record in the buffer */
-static unsigned char * getEndOfRecord (unsigned char *p_begin,
-                                            unsigned char *p_end)
+/*
+ * Hands out up to maxRecords of the full records in the buffer and returns
+ * how many. Sets *p_tooLong if it stopped at a record longer than
+ * maxRecordLen.
+ */
+static inline size_t getRecords (RecordStream *p_rs, RecordView *p_out, size_t maxRecords,
+                                 bool *p_tooLong)
 {
-    size_t len;
-    unsigned char * p_ret;
+    /* Work on copies: stores through p_out may alias the stream's fields. */
+    unsigned char *buffer = p_rs->buffer;
+    const size_t size = p_rs->size;
+    size_t head = p_rs->head;
+    size_t count = p_rs->count;
+    size_t n = 0;
+
+    *p_tooLong = false;
+    while (n < maxRecords && count >= HEADER_SIZE) {
+        uint32_t header;
+        size_t len, start, end;
+
+        //First four bytes are length
+        if (head + HEADER_SIZE <= size) {
+            memcpy(&header, buffer + head, HEADER_SIZE);
+        } else {
+            for (size_t i = 0; i < HEADER_SIZE; i++) {
+                size_t at = head + i;
+                ((unsigned char *)&header)[i] = buffer[at >= size ? at - size : at];
+            }
+        }
+        len = ntohl(header);
+
+        if (len > p_rs->maxRecordLen) {
+            *p_tooLong = true;
+            break;
+        }
+        if (count < HEADER_SIZE + len) {
+            break;
+        }
+
+        start = head + HEADER_SIZE;
+        if (start >= size) start -= size;
+        end = start + len;
+        if (end > size) {
+            /* make the record contiguous in the room after the ring */
+            memcpy(buffer + size, buffer, end - size);
+        }
+
+        p_out[n].data = buffer + start;
+        p_out[n].len = len;
+        n++;
 
-    if (p_end < p_begin + HEADER_SIZE) {
-        return NULL;
+        count -= HEADER_SIZE + len;
+        head = end >= size ? end - size : end;
     }
 
-    //First four bytes are length
-    len = ntohl(*((uint32_t *)p_begin));
+    p_rs->head = count == 0 ? 0 : head;
+    p_rs->count = count;
+    return n;
+}
 
-    p_ret = p_begin + HEADER_SIZE + len;
+/* Reads as much as fits in the free part of the ring, in one call. */
+static ssize_t fillBuffer (RecordStream *p_rs)
+{
+    size_t tail = p_rs->head + p_rs->count;
+    size_t space = p_rs->size - p_rs->count;
+    size_t first;
 
-    if (p_end < p_ret) {
-        return NULL;
+    if (tail >= p_rs->size) {
+        tail -= p_rs->size;
+    }
+    first = p_rs->size - tail;
+    if (first > space) {
+        first = space;
     }
 
-    return p_ret;
+#if defined(_WIN32)
+    ssize_t countRead = read (p_rs->fd, p_rs->buffer + tail, first);
+#else
+    struct iovec iov[2] = {
+        { p_rs->buffer + tail, first },
+        { p_rs->buffer, space - first },
+    };
+    ssize_t countRead = readv (p_rs->fd, iov, space > first ? 2 : 1);
+#endif
+
+    if (countRead > 0) {
+        p_rs->count += countRead;
+    }
+    return countRead;
 }
 
-static void *getNextRecord (RecordStream *p_rs, size_t *p_outRecordLen)
+static inline int getBatch (RecordStream *p_rs, RecordView *p_outRecords, size_t maxRecords)
 {
-    unsigned char *record_start, *record_end;
+    bool tooLong;
+    size_t n;
 
-    record_end = getEndOfRecord (p_rs->unconsumed, p_rs->read_end);
+    /* are there records already in the buffer? */
+    n = getRecords (p_rs, p_outRecords, maxRecords, &tooLong);
+    if (n > 0 || maxRecords == 0) {
+        return n;
+    }
+    if (tooLong) {
+        // this should never happen
+        //ALOGE("max record length exceeded\n");
+        errno = EFBIG;
+        return -1;
+    }
 
-    if (record_end != NULL) {
-        /* one full line in the buffer */
-        record_start = p_rs->unconsumed + HEADER_SIZE;
-        p_rs->unconsumed = record_end;
+    ssize_t countRead = fillBuffer (p_rs);
 
-        *p_outRecordLen = record_end - record_start;
+    if (countRead <= 0) {
+        return countRead;
+    }
 
-        return record_start;
+    n = getRecords (p_rs, p_outRecords, maxRecords, &tooLong);
+    if (n == 0) {
+        /* not enough of a buffer to for a whole command */
+        errno = tooLong ? EFBIG : EAGAIN;
+        return -1;
     }
+    return n;
+}
 
-    return NULL;
+int record_stream_get_batch (RecordStream *p_rs, RecordView *p_outRecords,
+                                    size_t maxRecords)
+{
+    return getBatch (p_rs, p_outRecords, maxRecords);
 }
 
 /**
  * Reads the next record from stream fd
- * Records are prefixed by a 16-bit big endian length value
+ * Records are prefixed by a 32-bit big endian length value
  * Records may not be larger than maxRecordLen
  *
  * Doesn't guard against EINTR
@@ -128,60 +226,19 @@ static void *getNextRecord (RecordStream *p_rs, size_t *p_outRecordLen)
 int record_stream_get_next (RecordStream *p_rs, void ** p_outRecord, 
                                     size_t *p_outRecordLen)
 {
-    void *ret;
-
-    ssize_t countRead;
+    RecordView view = { NULL, 0 };
+    int ret;
 
     /* is there one record already in the buffer? */
-    ret = getNextRecord (p_rs, p_outRecordLen);
+    ret = getBatch (p_rs, &view, 1);
 
-    if (ret != NULL) {
-        *p_outRecord = ret;
+    if (ret == 1) {
+        *p_outRecord = view.data;
+        *p_outRecordLen = view.len;
         return 0;
     }
 
-    // if the buffer is full and we don't have a full record
-    if (p_rs->unconsumed == p_rs->buffer 
-        && p_rs->read_end == p_rs->buffer_end
-    ) {
-        // this should never happen
-        //ALOGE("max record length exceeded\n");
-        assert (0);
-        errno = EFBIG;
-        return -1;
-    }
-
-    if (p_rs->unconsumed != p_rs->buffer) {
-        // move remainder to the beginning of the buffer
-        size_t toMove;
-
-        toMove = p_rs->read_end - p_rs->unconsumed;
-        if (toMove) {
-            memmove(p_rs->buffer, p_rs->unconsumed, toMove);
-        }
-
-        p_rs->read_end = p_rs->buffer + toMove;
-        p_rs->unconsumed = p_rs->buffer;
-    }
-
-    countRead = read (p_rs->fd, p_rs->read_end, p_rs->buffer_end - p_rs->read_end);
-
-    if (countRead <= 0) {
-        /* note: end-of-stream drops through here too */
-        *p_outRecord = NULL;
-        return countRead;
-    }
-
-    p_rs->read_end += countRead;
-
-    ret = getNextRecord (p_rs, p_outRecordLen);
-
-    if (ret == NULL) {
-        /* not enough of a buffer to for a whole command */
-        errno = EAGAIN;
-        return -1;
-    }
-
-    *p_outRecord = ret;        
-    return 0;
+    /* note: end-of-stream drops through here too */
+    *p_outRecord = NULL;
+    return ret;
 }
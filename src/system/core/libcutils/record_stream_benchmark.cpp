@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cutils/record_stream.h>
+
+#include <netinet/in.h>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+#include <android-base/logging.h>
+#include <android-base/unique_fd.h>
+#include <benchmark/benchmark.h>
+
+using android::base::unique_fd;
+
+static constexpr size_t kMaxRecordLen = 8192;
+
+// A RIL-style peer: streams records of one size over a socketpair, as fast
+// as the reader takes them, until the reader goes away.
+class Peer {
+  public:
+    explicit Peer(size_t record_len) {
+        int fds[2];
+        CHECK_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+        reader_.reset(fds[0]);
+        writer_.reset(fds[1]);
+
+        uint32_t len = htonl(record_len);
+        std::string record(reinterpret_cast<const char*>(&len), sizeof(len));
+        record.append(record_len, 'r');
+        while (chunk_.size() < 64 * 1024) chunk_ += record;
+
+        thread_ = std::thread([this] {
+            while (send(writer_, chunk_.data(), chunk_.size(), MSG_NOSIGNAL) > 0) {
+            }
+        });
+    }
+
+    ~Peer() {
+        shutdown(reader_, SHUT_RDWR);
+        thread_.join();
+    }
+
+    int fd() const { return reader_; }
+
+  private:
+    unique_fd reader_;
+    unique_fd writer_;
+    std::string chunk_;
+    std::thread thread_;
+};
+
+static void BM_record_stream_get_next(benchmark::State& state) {
+    Peer peer(state.range(0));
+    RecordStream* rs = record_stream_new(peer.fd(), kMaxRecordLen);
+    void* record;
+    size_t len;
+    while (state.KeepRunning()) {
+        while (record_stream_get_next(rs, &record, &len) != 0 || record == nullptr) {
+        }
+        benchmark::DoNotOptimize(record);
+    }
+    state.SetItemsProcessed(state.iterations());
+    record_stream_free(rs);
+}
+BENCHMARK(BM_record_stream_get_next)->Arg(16)->Arg(256)->Arg(4096);
+
+static void BM_record_stream_get_batch(benchmark::State& state) {
+    Peer peer(state.range(0));
+    RecordStream* rs = record_stream_new(peer.fd(), kMaxRecordLen);
+    RecordView views[64];
+    int pending = 0;
+    int next = 0;
+    // One record per iteration, taken from the current batch.
+    while (state.KeepRunning()) {
+        if (next == pending) {
+            while ((pending = record_stream_get_batch(rs, views, 64)) <= 0) {
+            }
+            next = 0;
+        }
+        benchmark::DoNotOptimize(views[next++].data);
+    }
+    state.SetItemsProcessed(state.iterations());
+    record_stream_free(rs);
+}
+BENCHMARK(BM_record_stream_get_batch)->Arg(16)->Arg(256)->Arg(4096);
+
+BENCHMARK_MAIN();
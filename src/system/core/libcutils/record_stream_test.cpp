@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cutils/record_stream.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+
+#include <android-base/file.h>
+#include <android-base/unique_fd.h>
+#include <gtest/gtest.h>
+
+using android::base::unique_fd;
+
+class RecordStreamTest : public testing::Test {
+  protected:
+    void SetUp() override {
+        int fds[2];
+        ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+        reader_.reset(fds[0]);
+        writer_.reset(fds[1]);
+    }
+
+    void Write(const std::string& record) {
+        uint32_t len = htonl(record.size());
+        std::string bytes(reinterpret_cast<const char*>(&len), sizeof(len));
+        bytes += record;
+        ASSERT_TRUE(android::base::WriteFully(writer_, bytes.data(), bytes.size()));
+    }
+
+    static std::string Record(size_t i) { return std::to_string(i) + std::string(i % 97, 'x'); }
+
+    unique_fd reader_;
+    unique_fd writer_;
+};
+
+TEST_F(RecordStreamTest, get_next) {
+    RecordStream* rs = record_stream_new(reader_, 128);
+    Write("hello");
+    Write("");
+    Write("world");
+
+    void* record;
+    size_t len;
+    ASSERT_EQ(0, record_stream_get_next(rs, &record, &len));
+    EXPECT_EQ("hello", std::string(static_cast<char*>(record), len));
+    ASSERT_EQ(0, record_stream_get_next(rs, &record, &len));
+    EXPECT_EQ(0U, len);
+    ASSERT_EQ(0, record_stream_get_next(rs, &record, &len));
+    EXPECT_EQ("world", std::string(static_cast<char*>(record), len));
+
+    writer_.reset();
+    ASSERT_EQ(0, record_stream_get_next(rs, &record, &len));
+    EXPECT_EQ(nullptr, record);
+    record_stream_free(rs);
+}
+
+TEST_F(RecordStreamTest, partial_record) {
+    RecordStream* rs = record_stream_new(reader_, 128);
+    uint32_t len = htonl(5);
+    ASSERT_TRUE(android::base::WriteFully(writer_, &len, sizeof(len)));
+    ASSERT_TRUE(android::base::WriteFully(writer_, "he", 2));
+
+    RecordView view;
+    errno = 0;
+    EXPECT_EQ(-1, record_stream_get_batch(rs, &view, 1));
+    EXPECT_EQ(EAGAIN, errno);
+
+    ASSERT_TRUE(android::base::WriteFully(writer_, "llo", 3));
+    ASSERT_EQ(1, record_stream_get_batch(rs, &view, 1));
+    EXPECT_EQ("hello", std::string(static_cast<char*>(view.data), view.len));
+    record_stream_free(rs);
+}
+
+TEST_F(RecordStreamTest, too_long) {
+    RecordStream* rs = record_stream_new(reader_, 4);
+    Write("hello");
+
+    RecordView view;
+    errno = 0;
+    EXPECT_EQ(-1, record_stream_get_batch(rs, &view, 1));
+    EXPECT_EQ(EFBIG, errno);
+    record_stream_free(rs);
+}
+
+// Enough records of varying sizes that they wrap around the buffer many
+// times, read back in batches and checked in order.
+TEST_F(RecordStreamTest, batches_wrap) {
+    const size_t kRecords = 20000;
+    RecordStream* rs = record_stream_new(reader_, 200);
+    ASSERT_EQ(0, fcntl(reader_, F_SETFL, O_NONBLOCK));
+
+    size_t written = 0;
+    size_t next = 0;
+    while (next < kRecords) {
+        // Keep the socket buffer from filling up.
+        while (written < kRecords && written < next + 100) {
+            Write(Record(written++));
+        }
+
+        RecordView views[16];
+        int n = record_stream_get_batch(rs, views, 16);
+        if (n < 0) {
+            ASSERT_EQ(EAGAIN, errno);
+            continue;
+        }
+        ASSERT_GT(n, 0);
+        for (int i = 0; i < n; i++) {
+            ASSERT_EQ(Record(next), std::string(static_cast<char*>(views[i].data), views[i].len));
+            next++;
+        }
+    }
+    record_stream_free(rs);
+}
@@ -0,0 +1,203 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <cutils/sockets.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#if !defined(__linux__)
+
+struct socket_server* socket_server_create(int, const struct socket_server_callbacks*, void*) {
+    errno = ENOSYS;
+    return nullptr;
+}
+
+int socket_server_get_fd(const struct socket_server*) {
+    errno = ENOSYS;
+    return -1;
+}
+
+int socket_server_poll(struct socket_server*, int) {
+    errno = ENOSYS;
+    return -1;
+}
+
+void socket_server_close_client(struct socket_server*, struct socket_server_client*) {}
+
+void socket_server_destroy(struct socket_server*) {}
+
+#else /* __linux__ */
+
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+#include <vector>
+
+// How many events one epoll_wait() returns at most.
+#define MAX_EVENTS 64
+// How many connections to accept per wakeup, so that a flood of them can't
+// starve the clients that are already connected.
+#define MAX_ACCEPTS 64
+
+namespace {
+
+struct Client {
+    socket_server_client client;  // Must come first.
+    Client* prev;
+    Client* next;
+};
+
+}  // namespace
+
+struct socket_server {
+    int epoll_fd;
+    int listen_fd;
+    socket_server_callbacks callbacks;
+    void* cookie;
+    // Every open client.
+    Client* clients;
+    // Clients closed since the last poll. A later event in the same batch
+    // may still point at them, so they are only freed after it.
+    std::vector<Client*> closed;
+};
+
+static void close_client(socket_server* server, Client* c) {
+    if (c->client.fd == -1) return;
+    if (server->callbacks.on_close) server->callbacks.on_close(&c->client, server->cookie);
+
+    // Remove it explicitly, in case the callbacks dup()ed the fd.
+    epoll_ctl(server->epoll_fd, EPOLL_CTL_DEL, c->client.fd, nullptr);
+    close(c->client.fd);
+    c->client.fd = -1;
+
+    if (c->prev) c->prev->next = c->next;
+    else server->clients = c->next;
+    if (c->next) c->next->prev = c->prev;
+    server->closed.push_back(c);
+}
+
+static void free_closed(socket_server* server) {
+    for (Client* c : server->closed) delete c;
+    server->closed.clear();
+}
+
+static void accept_clients(socket_server* server) {
+    for (int i = 0; i < MAX_ACCEPTS; i++) {
+        int fd = accept4(server->listen_fd, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK);
+        if (fd == -1) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            // Drained, or out of fds; the listener is level-triggered, so
+            // anything left is picked up by the next poll.
+            return;
+        }
+
+        struct ucred cred;
+        socklen_t len = sizeof(cred);
+        if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) == -1) {
+            close(fd);
+            continue;
+        }
+
+        Client* c = new Client{ { fd, cred.pid, cred.uid, cred.gid, nullptr }, nullptr, nullptr };
+        struct epoll_event event;
+        event.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+        event.data.ptr = c;
+        if (epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, fd, &event) == -1) {
+            close(fd);
+            delete c;
+            continue;
+        }
+        c->next = server->clients;
+        if (c->next) c->next->prev = c;
+        server->clients = c;
+
+        if (server->callbacks.on_connect &&
+            !server->callbacks.on_connect(&c->client, server->cookie)) {
+            close_client(server, c);
+        }
+    }
+}
+
+struct socket_server* socket_server_create(int listen_fd,
+                                           const struct socket_server_callbacks* callbacks,
+                                           void* cookie) {
+    if (callbacks == nullptr || callbacks->on_readable == nullptr) {
+        errno = EINVAL;
+        return nullptr;
+    }
+
+    int flags = fcntl(listen_fd, F_GETFL);
+    if (flags == -1 || fcntl(listen_fd, F_SETFL, flags | O_NONBLOCK) == -1) return nullptr;
+
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd == -1) return nullptr;
+
+    // The listener stays level-triggered: see accept_clients().
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.ptr = nullptr;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &event) == -1) {
+        int saved_errno = errno;
+        close(epoll_fd);
+        errno = saved_errno;
+        return nullptr;
+    }
+
+    return new socket_server{ epoll_fd, listen_fd, *callbacks, cookie, nullptr, {} };
+}
+
+int socket_server_get_fd(const struct socket_server* server) {
+    return server->epoll_fd;
+}
+
+int socket_server_poll(struct socket_server* server, int timeout_ms) {
+    struct epoll_event events[MAX_EVENTS];
+    int n = epoll_wait(server->epoll_fd, events, MAX_EVENTS, timeout_ms);
+    if (n == -1) return errno == EINTR ? 0 : -1;
+
+    for (int i = 0; i < n; i++) {
+        Client* c = static_cast<Client*>(events[i].data.ptr);
+        if (c == nullptr) {
+            accept_clients(server);
+            continue;
+        }
+        // Closed by a callback earlier in this batch.
+        if (c->client.fd == -1) continue;
+
+        bool keep = server->callbacks.on_readable(&c->client, server->cookie);
+        if (!keep || (events[i].events & (EPOLLHUP | EPOLLERR))) close_client(server, c);
+    }
+    free_closed(server);
+    return n;
+}
+
+void socket_server_close_client(struct socket_server* server,
+                                struct socket_server_client* client) {
+    close_client(server, reinterpret_cast<Client*>(client));
+}
+
+void socket_server_destroy(struct socket_server* server) {
+    if (server == nullptr) return;
+    while (server->clients) close_client(server, server->clients);
+    free_closed(server);
+    close(server->epoll_fd);
+    delete server;
+}
+
+#endif /* __linux__ */
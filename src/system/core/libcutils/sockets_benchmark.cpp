@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <cutils/sockets.h>
+
+#include <errno.h>
+#include <poll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <android-base/logging.h>
+#include <benchmark/benchmark.h>
+
+// Each iteration is one short-lived client: connect, send a request, read
+// the reply and hang up, while state.range(0) idle clients stay connected.
+// The server runs on its own thread, so only real time is meaningful.
+
+static bool EchoReadable(socket_server_client* client, void*) {
+    char buf[64];
+    while (true) {
+        ssize_t n = recv(client->fd, buf, sizeof(buf), 0);
+        if (n == 0) return false;
+        if (n == -1) return errno == EAGAIN;
+        if (send(client->fd, buf, n, 0) != n) return false;
+    }
+}
+
+static void EpollServer(int listen_fd, const std::atomic<bool>* stop) {
+    socket_server_callbacks callbacks = { nullptr, EchoReadable, nullptr };
+    socket_server* server = socket_server_create(listen_fd, &callbacks, nullptr);
+    CHECK(server != nullptr);
+    while (!*stop) socket_server_poll(server, 10);
+    socket_server_destroy(server);
+}
+
+// What most daemons do by hand: poll() over an array rebuilt every time
+// around the loop, and SO_PEERCRED read again for every request.
+static void PollServer(int listen_fd, const std::atomic<bool>* stop) {
+    std::vector<int> clients;
+    std::vector<pollfd> fds;
+    while (!*stop) {
+        fds.clear();
+        fds.push_back({ listen_fd, POLLIN, 0 });
+        for (int fd : clients) fds.push_back({ fd, POLLIN, 0 });
+        if (poll(fds.data(), fds.size(), 10) <= 0) continue;
+
+        if (fds[0].revents & POLLIN) {
+            int fd = accept(listen_fd, nullptr, nullptr);
+            if (fd != -1) clients.push_back(fd);
+        }
+        for (size_t i = 1; i < fds.size(); i++) {
+            if (fds[i].revents == 0) continue;
+            char buf[64];
+            ssize_t n = recv(fds[i].fd, buf, sizeof(buf), 0);
+            struct ucred cred;
+            socklen_t len = sizeof(cred);
+            if (n <= 0 || getsockopt(fds[i].fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) == -1 ||
+                send(fds[i].fd, buf, n, 0) != n) {
+                close(fds[i].fd);
+                clients.erase(std::find(clients.begin(), clients.end(), fds[i].fd));
+            }
+        }
+    }
+    for (int fd : clients) close(fd);
+}
+
+static void BM_socket_server(benchmark::State& state,
+                             void (*server)(int, const std::atomic<bool>*)) {
+    // Both ends of every connection live in this process.
+    struct rlimit rl;
+    getrlimit(RLIMIT_NOFILE, &rl);
+    rl.rlim_cur = rl.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &rl);
+
+    std::string name = "cutils_socket_server_benchmark_" + std::to_string(getpid());
+    int listen_fd = socket_local_server(name.c_str(), ANDROID_SOCKET_NAMESPACE_ABSTRACT,
+                                        SOCK_STREAM);
+    CHECK_NE(-1, listen_fd);
+    std::atomic<bool> stop(false);
+    std::thread thread(server, listen_fd, &stop);
+
+    auto connect = [&name]() {
+        int fd = socket_local_client(name.c_str(), ANDROID_SOCKET_NAMESPACE_ABSTRACT,
+                                     SOCK_STREAM);
+        CHECK_NE(-1, fd);
+        return fd;
+    };
+    std::vector<int> idle;
+    for (int i = 0; i < state.range(0); i++) idle.push_back(connect());
+
+    while (state.KeepRunning()) {
+        int fd = connect();
+        char c = 'x';
+        CHECK_EQ(1, send(fd, &c, 1, 0));
+        CHECK_EQ(1, recv(fd, &c, 1, 0));
+        close(fd);
+    }
+    state.SetItemsProcessed(state.iterations());
+
+    for (int fd : idle) close(fd);
+    stop = true;
+    thread.join();
+    close(listen_fd);
+}
+BENCHMARK_CAPTURE(BM_socket_server, poll, PollServer)->Arg(0)->Arg(100)->Arg(1000)->Arg(4000)
+        ->UseRealTime();
+BENCHMARK_CAPTURE(BM_socket_server, epoll, EpollServer)->Arg(0)->Arg(100)->Arg(1000)->Arg(4000)
+        ->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -142,3 +142,203 @@ TEST(SocketsTest, TestIpv6TcpLoopback) {
 TEST(SocketsTest, TestSocketSendBuffersFailure) {
     EXPECT_EQ(-1, socket_send_buffers(INVALID_SOCKET, nullptr, 0));
 }
+
+#if defined(__linux__)
+
+#include <unistd.h>
+
+#include <vector>
+
+namespace {
+
+struct EchoServer {
+    int connects = 0;
+    int closes = 0;
+    bool reject = false;
+    socket_server* server = nullptr;
+    std::vector<socket_server_client*> clients;
+    // Closed by the next other client that sends something.
+    socket_server_client* victim = nullptr;
+};
+
+bool EchoConnect(socket_server_client* client, void* cookie) {
+    EchoServer* echo = static_cast<EchoServer*>(cookie);
+    echo->connects++;
+    echo->clients.push_back(client);
+    client->data = echo;
+    return !echo->reject;
+}
+
+bool EchoReadable(socket_server_client* client, void* cookie) {
+    EchoServer* echo = static_cast<EchoServer*>(cookie);
+    char buf[128];
+    while (true) {
+        ssize_t n = recv(client->fd, buf, sizeof(buf), 0);
+        if (n == 0) return false;
+        if (n == -1) return errno == EAGAIN;
+        if (echo->victim != nullptr && echo->victim != client) {
+            socket_server_close_client(echo->server, echo->victim);
+            echo->victim = nullptr;
+        }
+        if (send(client->fd, buf, n, 0) != n) return false;
+    }
+}
+
+void EchoClose(socket_server_client* client, void* cookie) {
+    EXPECT_EQ(cookie, client->data);
+    static_cast<EchoServer*>(cookie)->closes++;
+}
+
+const socket_server_callbacks kEchoCallbacks = { EchoConnect, EchoReadable, EchoClose };
+
+class SocketServerTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        name_ = "cutils_socket_server_test_" + std::to_string(getpid());
+        listen_fd_ = socket_local_server(name_.c_str(), ANDROID_SOCKET_NAMESPACE_ABSTRACT,
+                                         SOCK_STREAM);
+        ASSERT_NE(-1, listen_fd_);
+        server_ = socket_server_create(listen_fd_, &kEchoCallbacks, &echo_);
+        ASSERT_NE(nullptr, server_);
+        echo_.server = server_;
+    }
+
+    void TearDown() override {
+        socket_server_destroy(server_);
+        close(listen_fd_);
+    }
+
+    int Connect() {
+        return socket_local_client(name_.c_str(), ANDROID_SOCKET_NAMESPACE_ABSTRACT,
+                                   SOCK_STREAM);
+    }
+
+    // Polls until the condition holds, or fails after a few seconds.
+    template <typename Pred>
+    void PollUntil(Pred pred) {
+        bool done;
+        for (int i = 0; !(done = pred()) && i < 1000; i++) {
+            ASSERT_NE(-1, socket_server_poll(server_, 10));
+        }
+        ASSERT_TRUE(done);
+    }
+
+    std::string name_;
+    int listen_fd_ = -1;
+    socket_server* server_ = nullptr;
+    EchoServer echo_;
+};
+
+}  // namespace
+
+TEST_F(SocketServerTest, Echo) {
+    int fd = Connect();
+    ASSERT_NE(-1, fd);
+    PollUntil([&] { return echo_.connects == 1; });
+
+    ASSERT_EQ(4, send(fd, "ping", 4, 0));
+    PollUntil([&] {
+        char buf[4];
+        return recv(fd, buf, sizeof(buf), MSG_DONTWAIT) == 4 && !memcmp(buf, "ping", 4);
+    });
+
+    close(fd);
+    PollUntil([&] { return echo_.closes == 1; });
+}
+
+TEST_F(SocketServerTest, Credentials) {
+    socket_server_client seen = {};
+    socket_server_callbacks callbacks = kEchoCallbacks;
+    callbacks.on_connect = [](socket_server_client* client, void* cookie) {
+        *static_cast<socket_server_client*>(cookie) = *client;
+        return true;
+    };
+    callbacks.on_close = nullptr;
+    socket_server* server = socket_server_create(listen_fd_, &callbacks, &seen);
+    ASSERT_NE(nullptr, server);
+
+    int fd = Connect();
+    ASSERT_NE(-1, fd);
+    for (int i = 0; i < 100 && seen.fd == 0; i++) socket_server_poll(server, 10);
+    EXPECT_EQ(getpid(), seen.pid);
+    EXPECT_EQ(getuid(), seen.uid);
+    EXPECT_EQ(getgid(), seen.gid);
+    socket_server_destroy(server);
+    close(fd);
+}
+
+TEST_F(SocketServerTest, Reject) {
+    echo_.reject = true;
+    int fd = Connect();
+    ASSERT_NE(-1, fd);
+    PollUntil([&] { return echo_.closes == 1; });
+    char c;
+    EXPECT_EQ(0, recv(fd, &c, 1, 0));
+    close(fd);
+}
+
+TEST_F(SocketServerTest, ManyClients) {
+    constexpr int kClients = 200;
+    std::vector<int> fds;
+    for (int i = 0; i < kClients; i++) {
+        int fd = Connect();
+        ASSERT_NE(-1, fd);
+        fds.push_back(fd);
+        // Keep within the listen backlog.
+        PollUntil([&] { return echo_.connects == i + 1; });
+    }
+    for (int fd : fds) ASSERT_EQ(1, send(fd, "x", 1, 0));
+    int replies = 0;
+    PollUntil([&] {
+        for (int& fd : fds) {
+            char c;
+            if (fd != -1 && recv(fd, &c, 1, MSG_DONTWAIT) == 1) {
+                close(fd);
+                fd = -1;
+                replies++;
+            }
+        }
+        return replies == kClients;
+    });
+    PollUntil([&] { return echo_.closes == kClients; });
+}
+
+TEST_F(SocketServerTest, CloseFromOtherCallback) {
+    int victim = Connect();
+    ASSERT_NE(-1, victim);
+    int fd = Connect();
+    ASSERT_NE(-1, fd);
+    PollUntil([&] { return echo_.connects == 2; });
+    echo_.victim = echo_.clients[0];
+
+    // Both are readable in the same poll, in either order: the victim's
+    // event must be skipped if it was closed first.
+    ASSERT_EQ(1, send(victim, "v", 1, 0));
+    ASSERT_EQ(1, send(fd, "x", 1, 0));
+    PollUntil([&] { return echo_.closes == 1; });
+    char c;
+    PollUntil([&] { return recv(fd, &c, 1, MSG_DONTWAIT) == 1; });
+    close(victim);
+    close(fd);
+}
+
+TEST_F(SocketServerTest, DestroyClosesClients) {
+    int fd = Connect();
+    ASSERT_NE(-1, fd);
+    PollUntil([&] { return echo_.connects == 1; });
+    socket_server_destroy(server_);
+    server_ = nullptr;
+    EXPECT_EQ(1, echo_.closes);
+    char c;
+    EXPECT_EQ(0, recv(fd, &c, 1, 0));
+    close(fd);
+}
+
+TEST(SocketServerCreateTest, NeedsOnReadable) {
+    socket_server_callbacks callbacks = {};
+    errno = 0;
+    EXPECT_EQ(nullptr, socket_server_create(0, &callbacks, nullptr));
+    EXPECT_EQ(EINVAL, errno);
+}
+
+#endif
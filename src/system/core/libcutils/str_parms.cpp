@@ -26,6 +26,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <algorithm>
+
 #include <cutils/hashmap.h>
 #include <cutils/memory.h>
 #include <log/log.h>
@@ -44,8 +46,27 @@ static void *released_pointer;
 #define RELEASE_OWNERSHIP(x)
 #endif
 
+struct str_parms_pair {
+    const char *key;
+    const char *value;
+    /* set for strings copied by str_parms_add_str() rather than
+     * pointing into the arena */
+    bool key_owned;
+    bool value_owned;
+    /* position in the input, so that later duplicates win */
+    size_t order;
+};
+
 struct str_parms {
     Hashmap *map;
+
+    /* Arena mode (map == NULL): pairs sorted by key. Until the array has to
+     * grow, it shares one allocation with the str_parms and the copy of the
+     * input that keys and values point into. */
+    struct str_parms_pair *pairs;
+    size_t count;
+    size_t capacity;
+    bool pairs_inline;
 };
 
 
@@ -116,8 +137,102 @@ do_remove:
     return should_continue;
 }
 
+static size_t arena_lower_bound(const struct str_parms *str_parms, const char *key)
+{
+    size_t lo = 0;
+    size_t hi = str_parms->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (strcmp(str_parms->pairs[mid].key, key) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static bool arena_find(const struct str_parms *str_parms, const char *key, size_t *index)
+{
+    *index = arena_lower_bound(str_parms, key);
+    return *index < str_parms->count && !strcmp(str_parms->pairs[*index].key, key);
+}
+
+static void arena_free_pair(struct str_parms_pair *pair)
+{
+    if (pair->key_owned)
+        free((void *)pair->key);
+    if (pair->value_owned)
+        free((void *)pair->value);
+}
+
+static int arena_reserve(struct str_parms *str_parms)
+{
+    if (str_parms->count < str_parms->capacity)
+        return 0;
+
+    size_t capacity = str_parms->capacity * 2 + 4;
+    str_parms_pair* pairs = static_cast<str_parms_pair*>(
+            malloc(capacity * sizeof(struct str_parms_pair)));
+    if (!pairs)
+        return -ENOMEM;
+
+    memcpy(pairs, str_parms->pairs, str_parms->count * sizeof(struct str_parms_pair));
+    if (!str_parms->pairs_inline)
+        free(str_parms->pairs);
+    str_parms->pairs = pairs;
+    str_parms->capacity = capacity;
+    str_parms->pairs_inline = false;
+    return 0;
+}
+
+static int arena_add_str(struct str_parms *str_parms, const char *key, const char *value)
+{
+    char *new_value = strdup(value);
+    if (!new_value)
+        return -ENOMEM;
+
+    size_t i;
+    if (arena_find(str_parms, key, &i)) {
+        struct str_parms_pair *pair = &str_parms->pairs[i];
+        if (pair->value_owned)
+            free((void *)pair->value);
+        pair->value = new_value;
+        pair->value_owned = true;
+        return 0;
+    }
+
+    char *new_key = strdup(key);
+    if (!new_key || arena_reserve(str_parms)) {
+        free(new_key);
+        free(new_value);
+        return -ENOMEM;
+    }
+    memmove(&str_parms->pairs[i + 1], &str_parms->pairs[i],
+            (str_parms->count - i) * sizeof(struct str_parms_pair));
+    str_parms->pairs[i] = {
+        .key = new_key,
+        .value = new_value,
+        .key_owned = true,
+        .value_owned = true,
+        .order = 0,
+    };
+    str_parms->count++;
+    return 0;
+}
+
 void str_parms_del(struct str_parms *str_parms, const char *key)
 {
+    if (!str_parms->map) {
+        size_t i;
+        if (arena_find(str_parms, key, &i)) {
+            arena_free_pair(&str_parms->pairs[i]);
+            memmove(&str_parms->pairs[i], &str_parms->pairs[i + 1],
+                    (str_parms->count - i - 1) * sizeof(struct str_parms_pair));
+            str_parms->count--;
+        }
+        return;
+    }
+
     struct remove_ctxt ctxt = {
         .str_parms = str_parms,
         .key = key,
@@ -127,6 +242,15 @@ void str_parms_del(struct str_parms *str_parms, const char *key)
 
 void str_parms_destroy(struct str_parms *str_parms)
 {
+    if (!str_parms->map) {
+        for (size_t i = 0; i < str_parms->count; i++)
+            arena_free_pair(&str_parms->pairs[i]);
+        if (!str_parms->pairs_inline)
+            free(str_parms->pairs);
+        free(str_parms);
+        return;
+    }
+
     struct remove_ctxt ctxt = {
         .str_parms = str_parms,
     };
@@ -203,9 +327,88 @@ err_create_str_parms:
     return NULL;
 }
 
+struct str_parms *str_parms_create_str_arena(const char *_string)
+{
+    size_t len = strlen(_string);
+    size_t max_pairs = 1;
+    for (const char *p = _string; *p; p++) {
+        if (*p == ';')
+            max_pairs++;
+    }
+
+    /* One allocation holds the str_parms, the pairs and the copy of the input. */
+    str_parms* s = static_cast<str_parms*>(
+            malloc(sizeof(struct str_parms) + max_pairs * sizeof(struct str_parms_pair) + len + 1));
+    if (!s)
+        return NULL;
+
+    s->map = NULL;
+    s->pairs = reinterpret_cast<str_parms_pair*>(s + 1);
+    s->count = 0;
+    s->capacity = max_pairs;
+    s->pairs_inline = true;
+
+    char *str = reinterpret_cast<char*>(s->pairs + max_pairs);
+    memcpy(str, _string, len + 1);
+
+    ALOGV("%s: source string == '%s'\n", __func__, _string);
+
+    /* Same rules as str_parms_create_str(), splitting the copy in place. */
+    char *p = str;
+    while (*p) {
+        char *kvpair = p;
+        size_t kvlen = strcspn(p, ";");
+        p += kvlen;
+        if (*p)
+            *p++ = '\0';
+        if (!kvlen)
+            continue;
+
+        char *eq = strchr(kvpair, '=');
+        if (eq == kvpair)
+            continue;
+
+        const char *value = "";
+        if (eq) {
+            *eq = '\0';
+            value = eq + 1;
+        }
+        s->pairs[s->count] = {
+            .key = kvpair,
+            .value = value,
+            .key_owned = false,
+            .value_owned = false,
+            .order = s->count,
+        };
+        s->count++;
+    }
+
+    if (!s->count)
+        ALOGV("%s: no items found in string\n", __func__);
+
+    /* Sort by key, then keep only the last occurrence of each key. */
+    std::sort(s->pairs, s->pairs + s->count,
+              [](const str_parms_pair& a, const str_parms_pair& b) {
+                  int cmp = strcmp(a.key, b.key);
+                  return cmp < 0 || (cmp == 0 && a.order < b.order);
+              });
+    size_t unique = 0;
+    for (size_t i = 0; i < s->count; i++) {
+        if (i + 1 < s->count && !strcmp(s->pairs[i].key, s->pairs[i + 1].key))
+            continue;
+        s->pairs[unique++] = s->pairs[i];
+    }
+    s->count = unique;
+
+    return s;
+}
+
 int str_parms_add_str(struct str_parms *str_parms, const char *key,
                       const char *value)
 {
+    if (!str_parms->map)
+        return arena_add_str(str_parms, key, value);
+
     void *tmp_key = NULL;
     void *tmp_val = NULL;
     void *old_val = NULL;
@@ -278,15 +481,24 @@ int str_parms_add_float(struct str_parms *str_parms, const char *key,
     return ret;
 }
 
+static const char *lookup(struct str_parms *str_parms, const char *key)
+{
+    if (!str_parms->map) {
+        size_t i;
+        return arena_find(str_parms, key, &i) ? str_parms->pairs[i].value : NULL;
+    }
+    // TODO: hashmapGet should take a const* key.
+    return static_cast<const char*>(hashmapGet(str_parms->map, (void*)key));
+}
+
 int str_parms_has_key(struct str_parms *str_parms, const char *key) {
-    return hashmapGet(str_parms->map, (void *)key) != NULL;
+    return lookup(str_parms, key) != NULL;
 }
 
 int str_parms_get_str(struct str_parms *str_parms, const char *key, char *val,
                       int len)
 {
-    // TODO: hashmapGet should take a const* key.
-    char* value = static_cast<char*>(hashmapGet(str_parms->map, (void*)key));
+    const char* value = lookup(str_parms, key);
     if (value)
         return strlcpy(val, value, len);
 
@@ -297,8 +509,7 @@ int str_parms_get_int(struct str_parms *str_parms, const char *key, int *val)
 {
     char *end;
 
-    // TODO: hashmapGet should take a const* key.
-    char* value = static_cast<char*>(hashmapGet(str_parms->map, (void*)key));
+    const char* value = lookup(str_parms, key);
     if (!value)
         return -ENOENT;
 
@@ -315,8 +526,7 @@ int str_parms_get_float(struct str_parms *str_parms, const char *key,
     float out;
     char *end;
 
-    // TODO: hashmapGet should take a const* key.
-    char* value = static_cast<char*>(hashmapGet(str_parms->map, (void*)(key)));
+    const char* value = lookup(str_parms, key);
     if (!value)
         return -ENOENT;
 
@@ -328,34 +538,64 @@ int str_parms_get_float(struct str_parms *str_parms, const char *key,
     return 0;
 }
 
-static bool combine_strings(void *key, void *value, void *context)
+struct to_str_ctxt {
+    char *buf;
+    size_t len;
+    size_t pos;
+};
+
+static void append_str(struct to_str_ctxt *ctxt, const char *str)
 {
-    char** old_str = static_cast<char**>(context);
-    char *new_str;
-    int ret;
+    size_t n = strlen(str);
+    if (ctxt->pos < ctxt->len) {
+        size_t room = ctxt->len - ctxt->pos - 1;
+        memcpy(ctxt->buf + ctxt->pos, str, std::min(n, room));
+    }
+    ctxt->pos += n;
+}
 
-    ret = asprintf(&new_str, "%s%s%s=%s",
-                   *old_str ? *old_str : "",
-                   *old_str ? ";" : "",
-                   (char *)key,
-                   (char *)value);
-    if (*old_str)
-        free(*old_str);
-
-    if (ret >= 0) {
-        *old_str = new_str;
-        return true;
+static bool append_pair(void *key, void *value, void *context)
+{
+    to_str_ctxt* ctxt = static_cast<to_str_ctxt*>(context);
+
+    if (ctxt->pos)
+        append_str(ctxt, ";");
+    append_str(ctxt, (const char *)key);
+    append_str(ctxt, "=");
+    append_str(ctxt, (const char *)value);
+    return true;
+}
+
+size_t str_parms_to_str_buf(struct str_parms *str_parms, char *buf, size_t len)
+{
+    struct to_str_ctxt ctxt = {
+        .buf = buf,
+        .len = len,
+        .pos = 0,
+    };
+
+    if (!str_parms->map) {
+        for (size_t i = 0; i < str_parms->count; i++)
+            append_pair((void *)str_parms->pairs[i].key, (void *)str_parms->pairs[i].value, &ctxt);
+    } else {
+        hashmapForEach(str_parms->map, append_pair, &ctxt);
     }
 
-    *old_str = NULL;
-    return false;
+    if (len)
+        buf[std::min(ctxt.pos, len - 1)] = '\0';
+    return ctxt.pos;
 }
 
 char *str_parms_to_str(struct str_parms *str_parms)
 {
-    char *str = NULL;
-    hashmapForEach(str_parms->map, combine_strings, &str);
-    return (str != NULL) ? str : strdup("");
+    /* Measure first, so the result is built with a single allocation. */
+    size_t len = str_parms_to_str_buf(str_parms, NULL, 0) + 1;
+    char* str = static_cast<char*>(malloc(len));
+    if (!str)
+        return NULL;
+
+    str_parms_to_str_buf(str_parms, str, len);
+    return str;
 }
 
 static bool dump_entry(void* key, void* value, void* /*context*/) {
@@ -365,5 +605,10 @@ static bool dump_entry(void* key, void* value, void* /*context*/) {
 
 void str_parms_dump(struct str_parms *str_parms)
 {
+    if (!str_parms->map) {
+        for (size_t i = 0; i < str_parms->count; i++)
+            dump_entry((void *)str_parms->pairs[i].key, (void *)str_parms->pairs[i].value, NULL);
+        return;
+    }
     hashmapForEach(str_parms->map, dump_entry, str_parms);
 }
@@ -15,6 +15,9 @@
  */
 
 #include <cutils/str_parms.h>
+
+#include <string>
+
 #include <gtest/gtest.h>
 
 static void test_str_parms_str(const char* str, const char* expected) {
@@ -55,3 +58,82 @@ TEST(str_parms, put_ENOMEM) {
     ASSERT_EQ(ENOMEM, errno);
     test_str_parms_str("foo=bar;baz=", "foo=bar;baz=");
 }
+
+static void test_str_parms_str_arena(const char* str, const char* expected) {
+    str_parms* str_parms = str_parms_create_str_arena(str);
+    str_parms_add_str(str_parms, "dude", "woah");
+    str_parms_add_str(str_parms, "dude", "woah");
+    str_parms_del(str_parms, "dude");
+    str_parms_dump(str_parms);
+    char* out_str = str_parms_to_str(str_parms);
+    str_parms_destroy(str_parms);
+    ASSERT_STREQ(expected, out_str) << str;
+    free(out_str);
+}
+
+TEST(str_parms, arena_smoke) {
+    // Arena mode lists pairs in key order.
+    test_str_parms_str_arena("", "");
+    test_str_parms_str_arena(";", "");
+    test_str_parms_str_arena("=", "");
+    test_str_parms_str_arena("=;", "");
+    test_str_parms_str_arena("=bar", "");
+    test_str_parms_str_arena("=bar;", "");
+    test_str_parms_str_arena("foo=", "foo=");
+    test_str_parms_str_arena("foo=;", "foo=");
+    test_str_parms_str_arena("foo=bar", "foo=bar");
+    test_str_parms_str_arena("foo=bar;", "foo=bar");
+    test_str_parms_str_arena("foo=bar;baz", "baz=;foo=bar");
+    test_str_parms_str_arena("foo=bar;baz=", "baz=;foo=bar");
+    test_str_parms_str_arena("foo=bar;baz=bat", "baz=bat;foo=bar");
+    test_str_parms_str_arena("foo=bar;baz=bat;", "baz=bat;foo=bar");
+    test_str_parms_str_arena("foo=bar1;baz=bat;foo=bar2", "baz=bat;foo=bar2");
+    test_str_parms_str_arena(";;a=1;;;c=3;b=2;a=4;", "a=4;b=2;c=3");
+}
+
+TEST(str_parms, arena_get_and_add) {
+    str_parms* str_parms = str_parms_create_str_arena("rate=48000;gain=0.5;name=spk;flag");
+    ASSERT_NE(nullptr, str_parms);
+
+    char buf[16];
+    ASSERT_EQ(3, str_parms_get_str(str_parms, "name", buf, sizeof(buf)));
+    ASSERT_STREQ("spk", buf);
+    int rate;
+    ASSERT_EQ(0, str_parms_get_int(str_parms, "rate", &rate));
+    ASSERT_EQ(48000, rate);
+    float gain;
+    ASSERT_EQ(0, str_parms_get_float(str_parms, "gain", &gain));
+    ASSERT_FLOAT_EQ(0.5f, gain);
+    ASSERT_TRUE(str_parms_has_key(str_parms, "flag"));
+    ASSERT_FALSE(str_parms_has_key(str_parms, "missing"));
+    ASSERT_EQ(-ENOENT, str_parms_get_str(str_parms, "missing", buf, sizeof(buf)));
+
+    // Adding more keys than the input had grows the pair array out of the arena.
+    for (int i = 0; i < 20; i++) {
+        ASSERT_EQ(0, str_parms_add_int(str_parms, ("k" + std::to_string(i)).c_str(), i));
+    }
+    ASSERT_EQ(0, str_parms_add_str(str_parms, "name", "hdmi"));
+    ASSERT_EQ(4, str_parms_get_str(str_parms, "name", buf, sizeof(buf)));
+    ASSERT_STREQ("hdmi", buf);
+    int k7;
+    ASSERT_EQ(0, str_parms_get_int(str_parms, "k7", &k7));
+    ASSERT_EQ(7, k7);
+
+    str_parms_destroy(str_parms);
+}
+
+TEST(str_parms, to_str_buf) {
+    str_parms* str_parms = str_parms_create_str_arena("a=1;b=22");
+    ASSERT_NE(nullptr, str_parms);
+
+    char buf[16];
+    ASSERT_EQ(8u, str_parms_to_str_buf(str_parms, buf, sizeof(buf)));
+    ASSERT_STREQ("a=1;b=22", buf);
+
+    // Truncated output is still terminated, and the full length is reported.
+    ASSERT_EQ(8u, str_parms_to_str_buf(str_parms, buf, 5));
+    ASSERT_STREQ("a=1;", buf);
+    ASSERT_EQ(8u, str_parms_to_str_buf(str_parms, nullptr, 0));
+
+    str_parms_destroy(str_parms);
+}
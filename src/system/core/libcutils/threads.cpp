@@ -46,11 +46,18 @@ pid_t gettid() {
 }
 #endif  // __ANDROID__
 
+// Once a store's key exists, has_tls is never cleared, so the common case
+// (every get, and every set after the first) needs no lock: an acquire load
+// of has_tls that sees 1 also sees the key it was published with.
+static inline int thread_store_ready(const thread_store_t* store) {
+    return __atomic_load_n(&store->has_tls, __ATOMIC_ACQUIRE);
+}
+
 #if !defined(_WIN32)
 
 void*  thread_store_get( thread_store_t*  store )
 {
-    if (!store->has_tls)
+    if (!thread_store_ready(store))
         return NULL;
 
     return pthread_getspecific( store->tls );
@@ -60,15 +67,17 @@ extern void   thread_store_set( thread_store_t*          store,
                                 void*                    value,
                                 thread_store_destruct_t  destroy)
 {
-    pthread_mutex_lock( &store->lock );
-    if (!store->has_tls) {
-        if (pthread_key_create( &store->tls, destroy) != 0) {
-            pthread_mutex_unlock(&store->lock);
-            return;
+    if (!thread_store_ready(store)) {
+        pthread_mutex_lock( &store->lock );
+        if (!store->has_tls) {
+            if (pthread_key_create( &store->tls, destroy) != 0) {
+                pthread_mutex_unlock(&store->lock);
+                return;
+            }
+            __atomic_store_n(&store->has_tls, 1, __ATOMIC_RELEASE);
         }
-        store->has_tls = 1;
+        pthread_mutex_unlock( &store->lock );
     }
-    pthread_mutex_unlock( &store->lock );
 
     pthread_setspecific( store->tls, value );
 }
@@ -76,7 +85,7 @@ extern void   thread_store_set( thread_store_t*          store,
 #else /* !defined(_WIN32) */
 void*  thread_store_get( thread_store_t*  store )
 {
-    if (!store->has_tls)
+    if (!thread_store_ready(store))
         return NULL;
 
     return (void*) TlsGetValue( store->tls );
@@ -87,24 +96,26 @@ void   thread_store_set( thread_store_t*          store,
                          thread_store_destruct_t  /*destroy*/ )
 {
     /* XXX: can't use destructor on thread exit */
-    if (!store->lock_init) {
-        store->lock_init = -1;
-        InitializeCriticalSection( &store->lock );
-        store->lock_init = -2;
-    } else while (store->lock_init != -2) {
-        Sleep(10); /* 10ms */
-    }
+    if (!thread_store_ready(store)) {
+        if (!store->lock_init) {
+            store->lock_init = -1;
+            InitializeCriticalSection( &store->lock );
+            store->lock_init = -2;
+        } else while (store->lock_init != -2) {
+            Sleep(10); /* 10ms */
+        }
 
-    EnterCriticalSection( &store->lock );
-    if (!store->has_tls) {
-        store->tls = TlsAlloc();
-        if (store->tls == TLS_OUT_OF_INDEXES) {
-            LeaveCriticalSection( &store->lock );
-            return;
+        EnterCriticalSection( &store->lock );
+        if (!store->has_tls) {
+            store->tls = TlsAlloc();
+            if (store->tls == TLS_OUT_OF_INDEXES) {
+                LeaveCriticalSection( &store->lock );
+                return;
+            }
+            __atomic_store_n(&store->has_tls, 1, __ATOMIC_RELEASE);
         }
-        store->has_tls = 1;
+        LeaveCriticalSection( &store->lock );
     }
-    LeaveCriticalSection( &store->lock );
 
     TlsSetValue( store->tls, value );
 }
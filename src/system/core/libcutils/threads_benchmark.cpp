@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cutils/threads.h>
+
+#include <pthread.h>
+
+#include <memory>
+
+#include <benchmark/benchmark.h>
+
+// Each thread sets and reads back its own value in a store shared by all of
+// them, as per-thread caches keyed off a global store do.
+
+static thread_store_t g_store = THREAD_STORE_INITIALIZER;
+
+static void BM_thread_store(benchmark::State& state) {
+    int value;
+    while (state.KeepRunning()) {
+        thread_store_set(&g_store, &value, nullptr);
+        benchmark::DoNotOptimize(thread_store_get(&g_store));
+    }
+}
+BENCHMARK(BM_thread_store)->ThreadRange(1, 8);
+
+static void BM_thread_store_get(benchmark::State& state) {
+    int value;
+    thread_store_set(&g_store, &value, nullptr);
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(thread_store_get(&g_store));
+    }
+}
+BENCHMARK(BM_thread_store_get)->ThreadRange(1, 8);
+
+// How thread_store_set() used to work: the store's lock on every call.
+static pthread_mutex_t g_locked_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t g_locked_key;
+static bool g_locked_has_key;
+
+static void BM_thread_store_locked_baseline(benchmark::State& state) {
+    int value;
+    while (state.KeepRunning()) {
+        pthread_mutex_lock(&g_locked_lock);
+        if (!g_locked_has_key) {
+            pthread_key_create(&g_locked_key, nullptr);
+            g_locked_has_key = true;
+        }
+        pthread_mutex_unlock(&g_locked_lock);
+        pthread_setspecific(g_locked_key, &value);
+        benchmark::DoNotOptimize(pthread_getspecific(g_locked_key));
+    }
+}
+BENCHMARK(BM_thread_store_locked_baseline)->ThreadRange(1, 8);
+
+struct Counter {
+    int count = 0;
+};
+
+static android::ThreadStore<Counter> g_counters;
+
+static void BM_ThreadStore_get_or_create(benchmark::State& state) {
+    while (state.KeepRunning()) {
+        g_counters.get_or_create().count++;
+    }
+}
+BENCHMARK(BM_ThreadStore_get_or_create)->ThreadRange(1, 8);
+
+static thread_local Counter t_counter;
+
+static void BM_thread_local_reference(benchmark::State& state) {
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(++t_counter.count);
+    }
+}
+BENCHMARK(BM_thread_local_reference)->ThreadRange(1, 8);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cutils/threads.h>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+static thread_store_t g_store = THREAD_STORE_INITIALIZER;
+
+TEST(threads, thread_store) {
+    EXPECT_EQ(nullptr, thread_store_get(&g_store));
+
+    int main_value;
+    thread_store_set(&g_store, &main_value, nullptr);
+    EXPECT_EQ(&main_value, thread_store_get(&g_store));
+
+    // Every thread sees only its own value, however many set at once.
+    std::vector<std::thread> threads;
+    std::vector<int> values(8);
+    std::vector<bool> ok(values.size());
+    for (size_t i = 0; i < values.size(); i++) {
+        threads.emplace_back([&, i] {
+            bool good = thread_store_get(&g_store) == nullptr;
+            for (int j = 0; j < 1000; j++) {
+                thread_store_set(&g_store, &values[i], nullptr);
+                good = good && thread_store_get(&g_store) == &values[i];
+            }
+            ok[i] = good;
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    for (size_t i = 0; i < ok.size(); i++) EXPECT_TRUE(ok[i]) << i;
+    EXPECT_EQ(&main_value, thread_store_get(&g_store));
+}
+
+struct Tracked {
+    explicit Tracked(int* live) : live(live) { ++*live; }
+    Tracked() : Tracked(&default_live) {}
+    ~Tracked() { --*live; }
+
+    int* live;
+    static int default_live;
+};
+int Tracked::default_live;
+
+static android::ThreadStore<Tracked> g_tracked;
+
+TEST(threads, ThreadStore) {
+    int live = 0;
+    std::thread([&] {
+        EXPECT_EQ(nullptr, g_tracked.get());
+        g_tracked.set(std::make_unique<Tracked>(&live));
+        EXPECT_EQ(1, live);
+        // Replacing a value deletes the old one.
+        g_tracked.set(std::make_unique<Tracked>(&live));
+        EXPECT_EQ(1, live);
+        EXPECT_EQ(&live, g_tracked.get()->live);
+    }).join();
+#if !defined(_WIN32)
+    // And so does the thread exiting.
+    EXPECT_EQ(0, live);
+#endif
+
+    std::thread([&] {
+        Tracked& tracked = g_tracked.get_or_create();
+        EXPECT_EQ(&tracked, &g_tracked.get_or_create());
+        EXPECT_EQ(1, Tracked::default_live);
+    }).join();
+}
@@ -0,0 +1,197 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "trace-binary.h"
+
+#include <inttypes.h>
+#include <string.h>
+
+#include <algorithm>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include <android-base/stringprintf.h>
+
+using android::base::StringAppendF;
+using android::base::StringPrintf;
+
+namespace {
+
+class Reader {
+  public:
+    Reader(const char* p, size_t len) : p_(p), end_(p + len) {}
+
+    bool done() const { return p_ == end_; }
+    size_t remaining() const { return end_ - p_; }
+    const char* pos() const { return p_; }
+
+    bool Byte(char* c) {
+        if (p_ == end_) return false;
+        *c = *p_++;
+        return true;
+    }
+
+    bool Varint(uint64_t* v) {
+        *v = 0;
+        for (int shift = 0; shift < 64 && p_ != end_; shift += 7) {
+            uint8_t b = *p_++;
+            *v |= static_cast<uint64_t>(b & 0x7f) << shift;
+            if ((b & 0x80) == 0) return true;
+        }
+        return false;
+    }
+
+    bool Bytes(size_t len, std::string* s) {
+        if (remaining() < len) return false;
+        s->assign(p_, len);
+        p_ += len;
+        return true;
+    }
+
+    bool Skip(size_t len) {
+        if (remaining() < len) return false;
+        p_ += len;
+        return true;
+    }
+
+  private:
+    const char* p_;
+    const char* end_;
+};
+
+struct ThreadState {
+    uint64_t ts = 0;
+    uint64_t tts = 0;
+    std::vector<std::string> names;  // Indexed by id - 1.
+};
+
+struct Event {
+    uint64_t ts;
+    int pid;
+    int tid;
+    std::string text;
+};
+
+bool ReadName(Reader* r, const ThreadState& state, std::string* name) {
+    uint64_t id;
+    if (!r->Varint(&id)) return false;
+    if (id == 0) {
+        uint64_t len;
+        return r->Varint(&len) && r->Bytes(len, name);
+    }
+    if (id > state.names.size()) return false;
+    *name = state.names[id - 1];
+    return true;
+}
+
+// Decodes one chunk's records into events.
+bool DecodeChunk(Reader* r, int pid, int tid, ThreadState* state, std::vector<Event>* events) {
+    while (!r->done()) {
+        char type;
+        r->Byte(&type);
+        if (type == ATRACE_BINARY_RESET) {
+            *state = ThreadState();
+            continue;
+        }
+        if (type == ATRACE_BINARY_NAME) {
+            uint64_t id, len;
+            std::string name;
+            if (!r->Varint(&id) || !r->Varint(&len) || !r->Bytes(len, &name)) return false;
+            if (id != state->names.size() + 1) return false;
+            state->names.push_back(std::move(name));
+            continue;
+        }
+
+        uint64_t dts, dtts;
+        if (!r->Varint(&dts) || !r->Varint(&dtts)) return false;
+        state->ts += dts;
+        state->tts += dtts;
+
+        Event event = { state->ts, pid, tid, "" };
+        std::string name;
+        uint64_t value;
+        switch (type) {
+            case 'B':
+                if (!ReadName(r, *state, &name)) return false;
+                event.text = StringPrintf("B|%d|%s", pid, name.c_str());
+                break;
+            case 'E':
+                event.text = StringPrintf("E|%d", pid);
+                break;
+            case 'S':
+            case 'F':
+            case 'C':
+                if (!ReadName(r, *state, &name) || !r->Varint(&value)) return false;
+                event.text = StringPrintf("%c|%d|%s|%" PRId64, type, pid, name.c_str(),
+                                          atrace_unzigzag(value));
+                break;
+            default:
+                return false;
+        }
+        events->push_back(std::move(event));
+    }
+    return true;
+}
+
+bool Decode(const std::string& in, std::vector<Event>* events) {
+    Reader r(in.data(), in.size());
+    std::map<std::pair<int, int>, ThreadState> threads;
+    if (in.compare(0, ATRACE_BINARY_MAGIC_SIZE, ATRACE_BINARY_MAGIC) != 0) return false;
+
+    while (!r.done()) {
+        if (r.remaining() >= ATRACE_BINARY_MAGIC_SIZE &&
+            memcmp(r.pos(), ATRACE_BINARY_MAGIC, ATRACE_BINARY_MAGIC_SIZE) == 0) {
+            // A new sink: every thread starts afresh.
+            threads.clear();
+            r.Skip(ATRACE_BINARY_MAGIC_SIZE);
+            continue;
+        }
+
+        char type;
+        uint64_t pid, tid, len;
+        r.Byte(&type);
+        if (type != ATRACE_BINARY_CHUNK || !r.Varint(&pid) || !r.Varint(&tid) ||
+            !r.Varint(&len) || r.remaining() < len) {
+            return false;
+        }
+        Reader chunk(r.pos(), len);
+        r.Skip(len);
+        if (!DecodeChunk(&chunk, pid, tid, &threads[{pid, tid}], events)) return false;
+    }
+    return true;
+}
+
+}  // namespace
+
+bool atrace_binary_to_systrace(const std::string& in, std::string* out) {
+    std::vector<Event> events;
+    bool ok = Decode(in, &events);
+
+    // Chunks from different threads arrive in the order they were flushed,
+    // not the order their events happened.
+    std::stable_sort(events.begin(), events.end(),
+                     [](const Event& a, const Event& b) { return a.ts < b.ts; });
+
+    out->append("# tracer: nop\n#\n");
+    for (const Event& event : events) {
+        StringAppendF(out, "           <...>-%-5d (%5d) [000] .... %5" PRIu64 ".%06" PRIu64
+                      ": tracing_mark_write: %s\n",
+                      event.tid, event.pid, event.ts / 1000000, event.ts % 1000000,
+                      event.text.c_str());
+    }
+    return ok;
+}
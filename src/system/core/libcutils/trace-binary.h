@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __TRACE_BINARY_H
+#define __TRACE_BINARY_H
+
+/*
+ * The binary trace format written by atrace_set_binary_fd().
+ *
+ * A stream starts with the 6-byte ATRACE_BINARY_MAGIC and is followed by
+ * chunks. Each chunk holds events from a single thread:
+ *
+ *   'T' pid tid length records[length]
+ *
+ * All integers are unsigned LEB128 varints; signed values (cookies and
+ * counter values) are zigzag encoded first. Each record starts with a type
+ * byte:
+ *
+ *   'R'                          reset this thread's state
+ *   'N' id length bytes          define name id (ids start at 1)
+ *   'B' dts dtts name            begin a slice
+ *   'E' dts dtts                 end the innermost slice
+ *   'S' dts dtts name cookie     begin an async slice
+ *   'F' dts dtts name cookie     end an async slice
+ *   'C' dts dtts name value      set a counter
+ *
+ * dts and dtts are the CLOCK_MONOTONIC and CLOCK_THREAD_CPUTIME_ID times, in
+ * microseconds, since the thread's previous event (or since 0 after 'R').
+ * name is a name id, or 0 followed by length and bytes for a name that
+ * wasn't interned. Name ids and times are per (pid, tid), which lets each
+ * thread encode without sharing any state with the others.
+ *
+ * The magic may appear again between chunks, when the sink is set again;
+ * decoders should forget all per-thread state when they see it.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+#define ATRACE_BINARY_MAGIC "\x7f" "ATRB\x01"
+#define ATRACE_BINARY_MAGIC_SIZE 6
+
+#define ATRACE_BINARY_CHUNK 'T'
+#define ATRACE_BINARY_RESET 'R'
+#define ATRACE_BINARY_NAME  'N'
+
+// A varint is at most this many bytes.
+#define ATRACE_VARINT_MAX 10
+
+static inline char* atrace_put_varint(char* p, uint64_t v) {
+    while (v >= 0x80) {
+        *p++ = static_cast<char>(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = static_cast<char>(v);
+    return p;
+}
+
+static inline uint64_t atrace_zigzag(int64_t v) {
+    return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+}
+
+static inline int64_t atrace_unzigzag(uint64_t v) {
+    return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+}
+
+/**
+ * Converts a binary trace to systrace text, sorted by timestamp. Returns
+ * false if the input is malformed or truncated; everything decoded up to
+ * that point is still written to out.
+ */
+bool atrace_binary_to_systrace(const std::string& in, std::string* out);
+
+#endif  // __TRACE_BINARY_H
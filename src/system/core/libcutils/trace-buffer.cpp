@@ -0,0 +1,516 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "cutils-trace"
+
+#include "trace-buffer.h"
+#include "trace-binary.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <new>
+
+#include <cutils/compiler.h>
+#include <cutils/trace.h>
+#include <log/log.h>
+
+/**
+ * Size of each thread's ring. Must be a power of 2.
+ */
+#define ATRACE_RING_SIZE (32 * 1024)
+
+/**
+ * How often the flusher drains rings that haven't filled up far enough to
+ * wake it.
+ */
+#define ATRACE_FLUSH_INTERVAL_NS (10 * 1000000)
+
+/**
+ * Size of each thread's binary name table, and how many names it interns
+ * before later names are written inline. Must be a power of 2.
+ */
+#define ATRACE_NAME_SLOTS 256
+#define ATRACE_NAME_MAX_IDS (ATRACE_NAME_SLOTS * 3 / 4)
+
+/**
+ * Longest name written in the binary format; longer names are truncated,
+ * as they are in the text formats.
+ */
+#define ATRACE_BINARY_MAX_NAME 1000
+
+struct atrace_name {
+    uint32_t hash;
+    uint32_t id;  // 0 if the slot is free.
+    size_t len;
+    char* str;
+};
+
+/*
+ * Each tracing thread owns a single-producer ring: only that thread advances
+ * head, so appending an event takes no lock and touches no shared cache
+ * line. Consumers (the flusher thread, atrace_flush(), or the owner when its
+ * ring is full) serialize on the ring's drain_lock and advance tail.
+ */
+struct atrace_ring {
+    std::atomic<size_t> head;
+    std::atomic<size_t> tail;
+    pthread_mutex_t drain_lock;
+    // Set when the owning thread exits; the ring is freed once drained.
+    std::atomic<bool> dead;
+    // Cached so formatting an event doesn't cost a syscall.
+    int tid;
+    atrace_ring* next;
+
+    // Whether the ring holds binary records. Only the owner changes it, with
+    // drain_lock held and the ring empty.
+    bool binary;
+    // Binary encoder state, only touched by the owner. It is valid for one
+    // sink: a new sink gets a new atrace_sink_generation.
+    uint32_t generation;
+    uint64_t last_ts;
+    uint64_t last_tts;
+    uint32_t name_count;
+    atrace_name names[ATRACE_NAME_SLOTS];
+
+    char data[ATRACE_RING_SIZE];
+};
+
+static std::atomic<int> atrace_buffered_fd(-1);
+static std::atomic<bool> atrace_buffered_binary(false);
+// Bumped for every binary sink; 0 is never a valid generation.
+static std::atomic<uint32_t> atrace_sink_generation(0);
+static int atrace_pid;
+
+// Guards the list of rings and the flusher thread's state.
+static pthread_mutex_t atrace_rings_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  atrace_flusher_cond = PTHREAD_COND_INITIALIZER;
+static atrace_ring*    atrace_rings = nullptr;
+static bool            atrace_flusher_running = false;
+static pthread_t       atrace_flusher_thread;
+
+static pthread_once_t atrace_ring_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t  atrace_ring_key;
+
+bool atrace_buffer_enabled() {
+    return atrace_buffered_fd.load(std::memory_order_relaxed) >= 0;
+}
+
+bool atrace_buffer_binary() {
+    return atrace_buffered_binary.load(std::memory_order_relaxed);
+}
+
+static void writev_fully(int fd, struct iovec* iov, int count) {
+    while (count > 0) {
+        ssize_t n = TEMP_FAILURE_RETRY(writev(fd, iov, count));
+        if (n <= 0) {
+            // Nothing sensible to do with trace data the sink won't take.
+            return;
+        }
+        while (count > 0 && static_cast<size_t>(n) >= iov->iov_len) {
+            n -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = static_cast<char*>(iov->iov_base) + n;
+            iov->iov_len -= n;
+        }
+    }
+}
+
+/**
+ * Writes out everything in the ring with a single writev(), preceded by a
+ * chunk header if it holds binary records. Must be called with the ring's
+ * drain_lock held.
+ */
+static void atrace_ring_drain_locked(atrace_ring* ring, int fd) {
+    size_t tail = ring->tail.load(std::memory_order_relaxed);
+    size_t head = ring->head.load(std::memory_order_acquire);
+    if (head == tail) return;
+
+    size_t start = tail & (ATRACE_RING_SIZE - 1);
+    size_t len = head - tail;
+    size_t first = std::min(len, static_cast<size_t>(ATRACE_RING_SIZE) - start);
+    char header[1 + 3 * ATRACE_VARINT_MAX];
+    struct iovec iov[3];
+    int count = 0;
+    if (ring->binary) {
+        char* p = header;
+        *p++ = ATRACE_BINARY_CHUNK;
+        p = atrace_put_varint(p, atrace_pid);
+        p = atrace_put_varint(p, ring->tid);
+        p = atrace_put_varint(p, len);
+        iov[count++] = { header, static_cast<size_t>(p - header) };
+    }
+    iov[count++] = { ring->data + start, first };
+    if (len > first) iov[count++] = { ring->data, len - first };
+    if (fd >= 0) {
+        writev_fully(fd, iov, count);
+    }
+    ring->tail.store(head, std::memory_order_release);
+}
+
+static void atrace_ring_drain(atrace_ring* ring, int fd) {
+    pthread_mutex_lock(&ring->drain_lock);
+    atrace_ring_drain_locked(ring, fd);
+    pthread_mutex_unlock(&ring->drain_lock);
+}
+
+static void atrace_ring_clear_names(atrace_ring* ring) {
+    for (atrace_name& name : ring->names) {
+        free(name.str);
+    }
+    memset(ring->names, 0, sizeof(ring->names));
+    ring->name_count = 0;
+}
+
+static void atrace_ring_free(atrace_ring* ring) {
+    atrace_ring_clear_names(ring);
+    pthread_mutex_destroy(&ring->drain_lock);
+    delete ring;
+}
+
+/**
+ * Drains every ring and frees those whose threads have exited. Must be
+ * called with atrace_rings_mutex held.
+ */
+static void atrace_drain_all_locked(int fd) {
+    atrace_ring** p = &atrace_rings;
+    while (*p != nullptr) {
+        atrace_ring* ring = *p;
+        atrace_ring_drain(ring, fd);
+        if (ring->dead.load(std::memory_order_acquire)) {
+            *p = ring->next;
+            atrace_ring_free(ring);
+            continue;
+        }
+        p = &ring->next;
+    }
+}
+
+static void* atrace_flusher_main(void*) {
+    pthread_mutex_lock(&atrace_rings_mutex);
+    while (atrace_flusher_running) {
+        atrace_drain_all_locked(atrace_buffered_fd.load(std::memory_order_relaxed));
+
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += ATRACE_FLUSH_INTERVAL_NS;
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+        pthread_cond_timedwait(&atrace_flusher_cond, &atrace_rings_mutex, &deadline);
+    }
+    pthread_mutex_unlock(&atrace_rings_mutex);
+    return nullptr;
+}
+
+/**
+ * Starts the flusher if buffering is on and it isn't running, which is also
+ * how a forked child gets one back. Must be called with atrace_rings_mutex
+ * held.
+ */
+static void atrace_start_flusher_locked() {
+    if (atrace_flusher_running || !atrace_buffer_enabled()) return;
+    int err = pthread_create(&atrace_flusher_thread, nullptr, atrace_flusher_main, nullptr);
+    if (err != 0) {
+        ALOGE("Error starting trace flusher: %s (%d)", strerror(err), err);
+        return;
+    }
+    atrace_flusher_running = true;
+}
+
+static void atrace_stop_flusher() {
+    pthread_mutex_lock(&atrace_rings_mutex);
+    if (!atrace_flusher_running) {
+        pthread_mutex_unlock(&atrace_rings_mutex);
+        return;
+    }
+    atrace_flusher_running = false;
+    pthread_cond_signal(&atrace_flusher_cond);
+    pthread_mutex_unlock(&atrace_rings_mutex);
+    pthread_join(atrace_flusher_thread, nullptr);
+}
+
+static void atrace_ring_thread_exit(void* arg) {
+    static_cast<atrace_ring*>(arg)->dead.store(true, std::memory_order_release);
+}
+
+// Hold every lock across fork() so the child doesn't inherit one mid-drain.
+static void atrace_prepare_fork() {
+    pthread_mutex_lock(&atrace_rings_mutex);
+    for (atrace_ring* ring = atrace_rings; ring != nullptr; ring = ring->next) {
+        pthread_mutex_lock(&ring->drain_lock);
+    }
+}
+
+static void atrace_parent_after_fork() {
+    for (atrace_ring* ring = atrace_rings; ring != nullptr; ring = ring->next) {
+        pthread_mutex_unlock(&ring->drain_lock);
+    }
+    pthread_mutex_unlock(&atrace_rings_mutex);
+}
+
+static void atrace_child_after_fork() {
+    // The parent still owns the buffered events and will write them; the
+    // child's copies would only duplicate them. Only the forking thread
+    // exists in the child, and the flusher is restarted on demand.
+    void* self = pthread_getspecific(atrace_ring_key);
+    for (atrace_ring* ring = atrace_rings; ring != nullptr; ring = ring->next) {
+        ring->tail.store(ring->head.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        if (ring != self) {
+            ring->dead.store(true, std::memory_order_relaxed);
+        } else {
+            // Binary state is per tid, so the child starts afresh.
+            ring->tid = gettid();
+            ring->generation = 0;
+        }
+        pthread_mutex_unlock(&ring->drain_lock);
+    }
+    atrace_flusher_running = false;
+    atrace_pid = getpid();
+    pthread_mutex_unlock(&atrace_rings_mutex);
+}
+
+static void atrace_ring_key_init() {
+    atrace_pid = getpid();
+    pthread_key_create(&atrace_ring_key, atrace_ring_thread_exit);
+    pthread_atfork(atrace_prepare_fork, atrace_parent_after_fork, atrace_child_after_fork);
+}
+
+static atrace_ring* atrace_get_ring() {
+    pthread_once(&atrace_ring_key_once, atrace_ring_key_init);
+    atrace_ring* ring = static_cast<atrace_ring*>(pthread_getspecific(atrace_ring_key));
+    if (CC_LIKELY(ring != nullptr)) {
+        return ring;
+    }
+
+    ring = new (std::nothrow) atrace_ring;
+    if (ring == nullptr) {
+        return nullptr;
+    }
+    ring->head.store(0, std::memory_order_relaxed);
+    ring->tail.store(0, std::memory_order_relaxed);
+    pthread_mutex_init(&ring->drain_lock, nullptr);
+    ring->dead.store(false, std::memory_order_relaxed);
+    ring->tid = gettid();
+    ring->binary = false;
+    ring->generation = 0;
+    ring->name_count = 0;
+    memset(ring->names, 0, sizeof(ring->names));
+
+    pthread_mutex_lock(&atrace_rings_mutex);
+    ring->next = atrace_rings;
+    atrace_rings = ring;
+    pthread_mutex_unlock(&atrace_rings_mutex);
+
+    pthread_setspecific(atrace_ring_key, ring);
+    return ring;
+}
+
+void atrace_buffer_get_ids(int* pid, int* tid) {
+    atrace_ring* ring = atrace_get_ring();
+    *pid = atrace_pid;
+    *tid = ring != nullptr ? ring->tid : gettid();
+}
+
+/**
+ * Switches the ring between text and binary records, writing out whatever
+ * it holds in the old format first.
+ */
+static void atrace_ring_set_binary(atrace_ring* ring, int fd, bool binary) {
+    pthread_mutex_lock(&ring->drain_lock);
+    atrace_ring_drain_locked(ring, fd);
+    ring->binary = binary;
+    pthread_mutex_unlock(&ring->drain_lock);
+}
+
+static void atrace_ring_append(atrace_ring* ring, int fd, const char* msg, size_t len) {
+    size_t head = ring->head.load(std::memory_order_relaxed);
+    size_t used = head - ring->tail.load(std::memory_order_acquire);
+    if (CC_UNLIKELY(ATRACE_RING_SIZE - used < len)) {
+        // The flusher has fallen behind. Write our own events out rather
+        // than drop them.
+        atrace_ring_drain(ring, fd);
+        used = head - ring->tail.load(std::memory_order_acquire);
+    }
+
+    size_t start = head & (ATRACE_RING_SIZE - 1);
+    size_t first = std::min(len, static_cast<size_t>(ATRACE_RING_SIZE) - start);
+    memcpy(ring->data + start, msg, first);
+    memcpy(ring->data, msg + first, len - first);
+    ring->head.store(head + len, std::memory_order_release);
+
+    // Wake the flusher early once the ring is half full, rather than wait
+    // for its next interval.
+    if (used < ATRACE_RING_SIZE / 2 && used + len >= ATRACE_RING_SIZE / 2) {
+        pthread_mutex_lock(&atrace_rings_mutex);
+        atrace_start_flusher_locked();
+        pthread_cond_signal(&atrace_flusher_cond);
+        pthread_mutex_unlock(&atrace_rings_mutex);
+    }
+}
+
+void atrace_buffer_write(const char* msg, size_t len) {
+    int fd = atrace_buffered_fd.load(std::memory_order_relaxed);
+    atrace_ring* ring = atrace_get_ring();
+    if (CC_UNLIKELY(ring == nullptr || len > ATRACE_RING_SIZE)) {
+        if (fd >= 0) TEMP_FAILURE_RETRY(write(fd, msg, len));
+        return;
+    }
+    if (CC_UNLIKELY(ring->binary)) {
+        atrace_ring_set_binary(ring, fd, false);
+    }
+    atrace_ring_append(ring, fd, msg, len);
+}
+
+static inline uint64_t atrace_time_us(clockid_t clk_id) {
+    struct timespec ts;
+    clock_gettime(clk_id, &ts);
+    return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+/**
+ * Returns the id of name in the ring's name table, appending an 'N' record
+ * to out if it is new, or 0 if the table is full.
+ */
+static uint32_t atrace_ring_intern(atrace_ring* ring, const char* name, size_t len, char** out) {
+    uint32_t hash = 2166136261u;  // FNV-1a
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ static_cast<uint8_t>(name[i])) * 16777619u;
+    }
+    for (uint32_t i = hash;; i++) {
+        atrace_name* slot = &ring->names[i & (ATRACE_NAME_SLOTS - 1)];
+        if (slot->id == 0) {
+            if (ring->name_count == ATRACE_NAME_MAX_IDS) return 0;
+            char* copy = static_cast<char*>(malloc(len));
+            if (copy == nullptr) return 0;
+            memcpy(copy, name, len);
+            *slot = { hash, ++ring->name_count, len, copy };
+
+            char* p = *out;
+            *p++ = ATRACE_BINARY_NAME;
+            p = atrace_put_varint(p, slot->id);
+            p = atrace_put_varint(p, len);
+            memcpy(p, name, len);
+            *out = p + len;
+            return slot->id;
+        }
+        if (slot->hash == hash && slot->len == len && memcmp(slot->str, name, len) == 0) {
+            return slot->id;
+        }
+    }
+}
+
+void atrace_buffer_write_binary(char type, const char* name, int64_t value) {
+    int fd = atrace_buffered_fd.load(std::memory_order_relaxed);
+    atrace_ring* ring = atrace_get_ring();
+    if (CC_UNLIKELY(ring == nullptr)) return;
+
+    uint32_t generation = atrace_sink_generation.load(std::memory_order_acquire);
+    char buf[2 * ATRACE_BINARY_MAX_NAME + 8 * ATRACE_VARINT_MAX] __attribute__((uninitialized));
+    char* p = buf;
+    if (CC_UNLIKELY(!ring->binary || ring->generation != generation)) {
+        atrace_ring_set_binary(ring, fd, true);
+        atrace_ring_clear_names(ring);
+        ring->generation = generation;
+        ring->last_ts = 0;
+        ring->last_tts = 0;
+        *p++ = ATRACE_BINARY_RESET;
+    }
+
+    // CLOCK_MONOTONIC and thread CPU time never go backwards on one thread.
+    uint64_t ts = atrace_time_us(CLOCK_MONOTONIC);
+    uint64_t tts = atrace_time_us(CLOCK_THREAD_CPUTIME_ID);
+    uint32_t id = 0;
+    size_t name_len = 0;
+    if (type != 'E') {
+        name_len = strnlen(name, ATRACE_BINARY_MAX_NAME + 1);
+        if (name_len > ATRACE_BINARY_MAX_NAME) {
+            ALOGW("Truncated name in %s: %s\n", __FUNCTION__, name);
+            name_len = ATRACE_BINARY_MAX_NAME;
+        }
+        id = atrace_ring_intern(ring, name, name_len, &p);
+    }
+
+    *p++ = type;
+    p = atrace_put_varint(p, ts - ring->last_ts);
+    p = atrace_put_varint(p, tts - ring->last_tts);
+    ring->last_ts = ts;
+    ring->last_tts = tts;
+    if (type != 'E') {
+        p = atrace_put_varint(p, id);
+        if (id == 0) {
+            p = atrace_put_varint(p, name_len);
+            memcpy(p, name, name_len);
+            p += name_len;
+        }
+    }
+    if (type == 'S' || type == 'F' || type == 'C') {
+        p = atrace_put_varint(p, atrace_zigzag(value));
+    }
+    atrace_ring_append(ring, fd, buf, p - buf);
+}
+
+void atrace_flush() {
+    pthread_mutex_lock(&atrace_rings_mutex);
+    atrace_drain_all_locked(atrace_buffered_fd.load(std::memory_order_relaxed));
+    pthread_mutex_unlock(&atrace_rings_mutex);
+}
+
+static int atrace_set_sink(int fd, bool binary) {
+    pthread_once(&atrace_ring_key_once, atrace_ring_key_init);
+
+    // Events already buffered belong to the previous sink.
+    atrace_flush();
+    if (binary && fd >= 0) {
+        struct iovec iov = { const_cast<char*>(ATRACE_BINARY_MAGIC), ATRACE_BINARY_MAGIC_SIZE };
+        writev_fully(fd, &iov, 1);
+        // Skip 0 on wraparound, since it marks a ring that never encoded.
+        if (atrace_sink_generation.fetch_add(1, std::memory_order_release) + 1 == 0) {
+            atrace_sink_generation.fetch_add(1, std::memory_order_release);
+        }
+    }
+    atrace_buffered_binary.store(binary && fd >= 0, std::memory_order_relaxed);
+    atrace_buffered_fd.store(fd, std::memory_order_relaxed);
+    if (fd < 0) {
+        atrace_stop_flusher();
+        return 0;
+    }
+
+    pthread_mutex_lock(&atrace_rings_mutex);
+    atrace_start_flusher_locked();
+    bool running = atrace_flusher_running;
+    pthread_mutex_unlock(&atrace_rings_mutex);
+    return running ? 0 : -EAGAIN;
+}
+
+int atrace_set_buffered_fd(int fd) {
+    return atrace_set_sink(fd, false);
+}
+
+int atrace_set_binary_fd(int fd) {
+    return atrace_set_sink(fd, true);
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __TRACE_BUFFER_H
+#define __TRACE_BUFFER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Returns true if atrace_set_buffered_fd() has redirected trace events to
+ * the per-thread buffers.
+ */
+bool atrace_buffer_enabled();
+
+/**
+ * Returns true if buffered events should be written with
+ * atrace_buffer_write_binary() rather than formatted as text.
+ */
+bool atrace_buffer_binary();
+
+/**
+ * Returns the calling process and thread ids for an event, without the
+ * syscalls getpid() and gettid() may cost.
+ */
+void atrace_buffer_get_ids(int* pid, int* tid);
+
+/**
+ * Appends one formatted event to the calling thread's buffer. Never blocks
+ * on other tracing threads; only blocks on the sink if the buffer is full.
+ */
+void atrace_buffer_write(const char* msg, size_t len);
+
+/**
+ * Encodes one event in the binary format described in trace-binary.h and
+ * appends it to the calling thread's buffer. type is the event's systrace
+ * letter; name is ignored for 'E', and value for 'B' and 'E'.
+ */
+void atrace_buffer_write_binary(char type, const char* name, int64_t value);
+
+#endif  // __TRACE_BUFFER_H
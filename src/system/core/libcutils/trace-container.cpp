@@ -19,9 +19,12 @@
 #include "trace-dev.inc"
 
 #include <cutils/sockets.h>
+#include <sched.h>
 #include <sys/stat.h>
 #include <time.h>
 
+#include <new>
+
 /**
  * For tracing in container, tags are written into a socket
  * instead of ftrace. Additional data is appended so we need extra space.
@@ -32,36 +35,136 @@ static pthread_once_t atrace_once_control = PTHREAD_ONCE_INIT;
 
 // Variables used for tracing in container with socket.
 // Note that we need to manually close and reopen socket when Zygote is forking. This requires
-// writing and closing sockets on multiple threads. A rwlock is used for avoiding concurrent
-// operation on the file descriptor.
+// writing and closing sockets on multiple threads. Rather than have every event take a shared
+// lock, each writing thread owns a reader slot that it marks busy while it uses the socket, so
+// writers share no cache lines. Closing the socket unpublishes it first, then waits for every
+// busy slot to go idle before the fd can be closed and reused.
+struct atrace_sock_reader {
+    atomic_bool busy;
+    atomic_bool in_use;
+    struct atrace_sock_reader* next;
+} __attribute__((aligned(64)));
+
 static bool             atrace_use_container_sock    = false;
-static int              atrace_container_sock_fd     = -1;
+static atomic_int       atrace_container_sock_fd     = ATOMIC_VAR_INIT(-1);
 static pthread_mutex_t  atrace_enabling_mutex        = PTHREAD_MUTEX_INITIALIZER;
-static pthread_rwlock_t atrace_container_sock_rwlock = PTHREAD_RWLOCK_INITIALIZER;
+
+// Reader slots are never freed: a thread's slot is released for reuse when it exits.
+static pthread_mutex_t            atrace_sock_readers_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct atrace_sock_reader* atrace_sock_readers       = NULL;
+static pthread_once_t             atrace_sock_reader_once   = PTHREAD_ONCE_INIT;
+static pthread_key_t              atrace_sock_reader_key;
+
+static void atrace_init_once();
 
 static void atrace_seq_number_changed(uint32_t, uint32_t seq_no) {
     pthread_once(&atrace_once_control, atrace_init_once);
     atomic_store_explicit(&last_sequence_number, seq_no, memory_order_relaxed);
 }
 
+static void atrace_sock_reader_release(void* arg)
+{
+    struct atrace_sock_reader* reader = (struct atrace_sock_reader*) arg;
+    atomic_store_explicit(&reader->in_use, false, memory_order_release);
+}
+
+// Only the forking thread survives in the child, so no other slot can be busy there.
+static void atrace_sock_readers_prepare_fork()
+{
+    pthread_mutex_lock(&atrace_sock_readers_mutex);
+}
+
+static void atrace_sock_readers_parent_after_fork()
+{
+    pthread_mutex_unlock(&atrace_sock_readers_mutex);
+}
+
+static void atrace_sock_readers_child_after_fork()
+{
+    for (struct atrace_sock_reader* r = atrace_sock_readers; r != NULL; r = r->next) {
+        atomic_store_explicit(&r->busy, false, memory_order_relaxed);
+    }
+    pthread_mutex_unlock(&atrace_sock_readers_mutex);
+}
+
+static void atrace_sock_reader_init()
+{
+    pthread_key_create(&atrace_sock_reader_key, atrace_sock_reader_release);
+    pthread_atfork(atrace_sock_readers_prepare_fork, atrace_sock_readers_parent_after_fork,
+                   atrace_sock_readers_child_after_fork);
+}
+
+static struct atrace_sock_reader* atrace_get_sock_reader()
+{
+    pthread_once(&atrace_sock_reader_once, atrace_sock_reader_init);
+    struct atrace_sock_reader* reader =
+        (struct atrace_sock_reader*) pthread_getspecific(atrace_sock_reader_key);
+    if (CC_LIKELY(reader != NULL)) return reader;
+
+    pthread_mutex_lock(&atrace_sock_readers_mutex);
+    for (reader = atrace_sock_readers; reader != NULL; reader = reader->next) {
+        if (!atomic_load_explicit(&reader->in_use, memory_order_acquire)) break;
+    }
+    if (reader == NULL) {
+        reader = new (std::nothrow) atrace_sock_reader;
+        if (reader != NULL) {
+            atomic_init(&reader->busy, false);
+            reader->next = atrace_sock_readers;
+            atrace_sock_readers = reader;
+        }
+    }
+    if (reader != NULL) {
+        atomic_store_explicit(&reader->in_use, true, memory_order_relaxed);
+        pthread_setspecific(atrace_sock_reader_key, reader);
+    }
+    pthread_mutex_unlock(&atrace_sock_readers_mutex);
+    return reader;
+}
+
+// Returns the socket with the calling thread's slot marked busy, or -1. The fd stays open
+// until atrace_put_container_sock().
+static inline int atrace_get_container_sock(struct atrace_sock_reader* reader)
+{
+    // The store to busy must be ordered before the load of the fd, pairing with the exchange
+    // and the loads of busy in atrace_close_container_sock(). seq_cst gives exactly that.
+    atomic_store_explicit(&reader->busy, true, memory_order_seq_cst);
+    int fd = atomic_load_explicit(&atrace_container_sock_fd, memory_order_seq_cst);
+    if (fd == -1) {
+        atomic_store_explicit(&reader->busy, false, memory_order_release);
+    }
+    return fd;
+}
+
+static inline void atrace_put_container_sock(struct atrace_sock_reader* reader)
+{
+    atomic_store_explicit(&reader->busy, false, memory_order_release);
+}
+
 static bool atrace_init_container_sock()
 {
-    pthread_rwlock_wrlock(&atrace_container_sock_rwlock);
-    atrace_container_sock_fd =
-        socket_local_client("trace", ANDROID_SOCKET_NAMESPACE_RESERVED, SOCK_SEQPACKET);
-    if (atrace_container_sock_fd < 0) {
+    int fd = socket_local_client("trace", ANDROID_SOCKET_NAMESPACE_RESERVED, SOCK_SEQPACKET);
+    if (fd < 0) {
         ALOGE("Error opening container trace socket: %s (%d)", strerror(errno), errno);
     }
-    pthread_rwlock_unlock(&atrace_container_sock_rwlock);
-    return atrace_container_sock_fd != -1;
+    atomic_store_explicit(&atrace_container_sock_fd, fd, memory_order_release);
+    return fd != -1;
 }
 
 static void atrace_close_container_sock()
 {
-    pthread_rwlock_wrlock(&atrace_container_sock_rwlock);
-    if (atrace_container_sock_fd != -1) close(atrace_container_sock_fd);
-    atrace_container_sock_fd = -1;
-    pthread_rwlock_unlock(&atrace_container_sock_rwlock);
+    int fd = atomic_exchange_explicit(&atrace_container_sock_fd, -1, memory_order_seq_cst);
+    if (fd == -1) return;
+
+    // Writers that saw the old fd marked their slots busy before loading it. Once every
+    // slot has been seen idle, no writer can still be using it.
+    pthread_mutex_lock(&atrace_sock_readers_mutex);
+    for (struct atrace_sock_reader* r = atrace_sock_readers; r != NULL; r = r->next) {
+        while (atomic_load_explicit(&r->busy, memory_order_seq_cst)) {
+            sched_yield();
+        }
+    }
+    pthread_mutex_unlock(&atrace_sock_readers_mutex);
+    close(fd);
 }
 
 // Set whether tracing is enabled in this process.  This is used to prevent
@@ -122,16 +225,9 @@ void atrace_setup()
     pthread_once(&atrace_once_control, atrace_init_once);
 }
 
-static inline uint64_t gettime(clockid_t clk_id)
-{
-    struct timespec ts;
-    clock_gettime(clk_id, &ts);
-    return ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
-}
-
 // Write trace events to container trace file. Note that we need to amend tid and time information
 // here comparing to normal ftrace, where those informations are added by kernel.
-#define WRITE_MSG_IN_CONTAINER_LOCKED(ph, sep_before_name, value_format, name, value) { \
+#define WRITE_MSG_IN_CONTAINER_FD(fd, ph, sep_before_name, value_format, name, value) { \
     char buf[CONTAINER_ATRACE_MESSAGE_LENGTH]; \
     int pid = getpid(); \
     int tid = gettid(); \
@@ -157,16 +253,19 @@ static inline uint64_t gettime(clockid_t clk_id)
         } \
     } \
     if (len > 0) { \
-        write(atrace_container_sock_fd, buf, len); \
+        write(fd, buf, len); \
     } \
 }
 
 #define WRITE_MSG_IN_CONTAINER(ph, sep_before_name, value_format, name, value) { \
-    pthread_rwlock_rdlock(&atrace_container_sock_rwlock); \
-    if (atrace_container_sock_fd != -1) { \
-       WRITE_MSG_IN_CONTAINER_LOCKED(ph, sep_before_name, value_format, name, value); \
+    struct atrace_sock_reader* reader = atrace_get_sock_reader(); \
+    if (reader != NULL) { \
+        int fd = atrace_get_container_sock(reader); \
+        if (fd != -1) { \
+            WRITE_MSG_IN_CONTAINER_FD(fd, ph, sep_before_name, value_format, name, value); \
+            atrace_put_container_sock(reader); \
+        } \
     } \
-    pthread_rwlock_unlock(&atrace_container_sock_rwlock); \
 }
 
 void atrace_begin_body(const char* name)
@@ -71,30 +71,60 @@ void atrace_setup()
 
 void atrace_begin_body(const char* name)
 {
+    if (CC_UNLIKELY(atrace_buffer_enabled())) {
+        WRITE_MSG_BUFFERED("B", "|", "%s", name, "", 0);
+        return;
+    }
+
     WRITE_MSG("B|%d|", "%s", name, "");
 }
 
 void atrace_end_body()
 {
+    if (CC_UNLIKELY(atrace_buffer_enabled())) {
+        WRITE_MSG_BUFFERED("E", "", "%s", "", "", 0);
+        return;
+    }
+
     WRITE_MSG("E|%d", "%s", "", "");
 }
 
 void atrace_async_begin_body(const char* name, int32_t cookie)
 {
+    if (CC_UNLIKELY(atrace_buffer_enabled())) {
+        WRITE_MSG_BUFFERED("S", "|", "|%" PRId32, name, cookie, cookie);
+        return;
+    }
+
     WRITE_MSG("S|%d|", "|%" PRId32, name, cookie);
 }
 
 void atrace_async_end_body(const char* name, int32_t cookie)
 {
+    if (CC_UNLIKELY(atrace_buffer_enabled())) {
+        WRITE_MSG_BUFFERED("F", "|", "|%" PRId32, name, cookie, cookie);
+        return;
+    }
+
     WRITE_MSG("F|%d|", "|%" PRId32, name, cookie);
 }
 
 void atrace_int_body(const char* name, int32_t value)
 {
+    if (CC_UNLIKELY(atrace_buffer_enabled())) {
+        WRITE_MSG_BUFFERED("C", "|", "|%" PRId32, name, value, value);
+        return;
+    }
+
     WRITE_MSG("C|%d|", "|%" PRId32, name, value);
 }
 
 void atrace_int64_body(const char* name, int64_t value)
 {
+    if (CC_UNLIKELY(atrace_buffer_enabled())) {
+        WRITE_MSG_BUFFERED("C", "|", "|%" PRId64, name, value, value);
+        return;
+    }
+
     WRITE_MSG("C|%d|", "|%" PRId64, name, value);
 }
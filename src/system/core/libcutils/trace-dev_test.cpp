@@ -17,14 +17,19 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <map>
 #include <memory>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include <android-base/file.h>
 #include <android-base/stringprintf.h>
+#include <android-base/strings.h>
 #include <gtest/gtest.h>
 
 #include "../trace-dev.cpp"
+#include "trace-binary.h"
 
 class TraceDevTest : public ::testing::Test {
  protected:
@@ -292,3 +297,213 @@ TEST_F(TraceDevTest, atrace_int64_body_truncated) {
   expected += android::base::StringPrintf("%.*s|17179869183", expected_len, name.c_str());
   ASSERT_STREQ(expected.c_str(), actual.c_str());
 }
+
+class TraceDevBufferedTest : public TraceDevTest {
+ protected:
+  void SetUp() override {
+    TraceDevTest::SetUp();
+    ASSERT_EQ(0, atrace_set_buffered_fd(sink_.fd));
+  }
+
+  void TearDown() override {
+    atrace_set_buffered_fd(-1);
+    TraceDevTest::TearDown();
+  }
+
+  std::vector<std::string> ReadSink() {
+    atrace_flush();
+    std::string contents;
+    lseek(sink_.fd, 0, SEEK_SET);
+    EXPECT_TRUE(android::base::ReadFdToString(sink_.fd, &contents));
+    return android::base::Split(contents, "\n");
+  }
+
+  // Strips the timestamps, which can't be predicted, from an event line.
+  static std::string WithoutTimes(const std::string& line) {
+    std::vector<std::string> fields = android::base::Split(line, "|");
+    if (fields.size() < 5) return line;
+    fields.erase(fields.begin() + 3, fields.begin() + 5);
+    return android::base::Join(fields, "|");
+  }
+
+  TemporaryFile sink_;
+};
+
+TEST_F(TraceDevBufferedTest, events_are_buffered_until_flushed) {
+  atrace_begin_body("fake_name");
+  atrace_int_body("counter", 12345);
+  atrace_async_begin_body("async", 7);
+  atrace_end_body();
+
+  // Nothing went to the kernel trace buffer.
+  ASSERT_EQ(0, lseek(atrace_marker_fd, 0, SEEK_END));
+
+  std::vector<std::string> lines = ReadSink();
+  ASSERT_EQ(5U, lines.size());
+  std::string prefix = android::base::StringPrintf("|%d|%d", getpid(), gettid());
+  EXPECT_EQ("B" + prefix + "|fake_name", WithoutTimes(lines[0]));
+  EXPECT_EQ("C" + prefix + "|counter|12345", WithoutTimes(lines[1]));
+  EXPECT_EQ("S" + prefix + "|async|7", WithoutTimes(lines[2]));
+  EXPECT_EQ("E" + prefix, WithoutTimes(lines[3]));
+  EXPECT_EQ("", lines[4]);
+}
+
+TEST_F(TraceDevBufferedTest, timestamps_are_taken_when_traced) {
+  atrace_begin_body("slice");
+  usleep(20000);
+  atrace_end_body();
+
+  std::vector<std::string> lines = ReadSink();
+  ASSERT_EQ(3U, lines.size());
+  uint64_t begin = std::stoull(android::base::Split(lines[0], "|")[3]);
+  uint64_t end = std::stoull(android::base::Split(lines[1], "|")[3]);
+  EXPECT_GE(end - begin, 20000U);
+}
+
+TEST_F(TraceDevBufferedTest, per_thread_order) {
+  const int kEvents = 10000;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([]() {
+      for (int i = 0; i < kEvents; i++) atrace_int_body("n", i);
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  std::map<std::string, int> next;
+  size_t events = 0;
+  for (const std::string& line : ReadSink()) {
+    if (line.empty()) continue;
+    std::vector<std::string> fields = android::base::Split(line, "|");
+    ASSERT_EQ(7U, fields.size()) << line;
+    ASSERT_EQ(next[fields[2]]++, std::stoi(fields[6])) << line;
+    events++;
+  }
+  ASSERT_EQ(4U * kEvents, events);
+}
+
+class TraceDevBinaryTest : public TraceDevTest {
+ protected:
+  void SetUp() override {
+    TraceDevTest::SetUp();
+    ASSERT_EQ(0, atrace_set_binary_fd(sink_.fd));
+  }
+
+  void TearDown() override {
+    atrace_set_buffered_fd(-1);
+    TraceDevTest::TearDown();
+  }
+
+  std::string ReadSink() {
+    atrace_flush();
+    std::string contents;
+    lseek(sink_.fd, 0, SEEK_SET);
+    EXPECT_TRUE(android::base::ReadFdToString(sink_.fd, &contents));
+    return contents;
+  }
+
+  // Returns the decoded events as "tid:payload", without the header.
+  static std::vector<std::string> Decode(const std::string& binary) {
+    std::string text;
+    EXPECT_TRUE(atrace_binary_to_systrace(binary, &text));
+    std::vector<std::string> events;
+    for (const std::string& line : android::base::Split(text, "\n")) {
+      if (line.empty() || line[0] == '#') continue;
+      size_t dash = line.find('-');
+      size_t marker = line.find(": tracing_mark_write: ");
+      EXPECT_NE(std::string::npos, marker) << line;
+      events.push_back(std::to_string(std::stoi(line.substr(dash + 1))) + ":" +
+                       line.substr(marker + strlen(": tracing_mark_write: ")));
+    }
+    return events;
+  }
+
+  TemporaryFile sink_;
+};
+
+TEST_F(TraceDevBinaryTest, round_trip) {
+  atrace_begin_body("fake_name");
+  atrace_int_body("counter", -12345);
+  atrace_int64_body("counter", INT64_MAX);
+  atrace_async_begin_body("async", 7);
+  atrace_async_end_body("async", 7);
+  atrace_end_body();
+
+  // Nothing went to the kernel trace buffer.
+  ASSERT_EQ(0, lseek(atrace_marker_fd, 0, SEEK_END));
+
+  std::string prefix = android::base::StringPrintf("%d:", gettid());
+  std::string pid = std::to_string(getpid());
+  std::vector<std::string> events = Decode(ReadSink());
+  ASSERT_EQ(6U, events.size());
+  EXPECT_EQ(prefix + "B|" + pid + "|fake_name", events[0]);
+  EXPECT_EQ(prefix + "C|" + pid + "|counter|-12345", events[1]);
+  EXPECT_EQ(prefix + "C|" + pid + "|counter|9223372036854775807", events[2]);
+  EXPECT_EQ(prefix + "S|" + pid + "|async|7", events[3]);
+  EXPECT_EQ(prefix + "F|" + pid + "|async|7", events[4]);
+  EXPECT_EQ(prefix + "E|" + pid, events[5]);
+}
+
+TEST_F(TraceDevBinaryTest, names_are_interned) {
+  const int kEvents = 1000;
+  for (int i = 0; i < kEvents; i++) atrace_int_body("a_fairly_long_counter_name", i);
+
+  // The name is written once; each update is a few bytes of varints.
+  std::string binary = ReadSink();
+  EXPECT_LT(binary.size(), 8U * kEvents);
+  ASSERT_EQ(static_cast<size_t>(kEvents), Decode(binary).size());
+}
+
+TEST_F(TraceDevBinaryTest, per_thread_order) {
+  // More names than a thread's table holds, so some are written inline.
+  const int kEvents = 10000;
+  const int kNames = 500;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([]() {
+      for (int i = 0; i < kEvents; i++) {
+        atrace_int_body(("n" + std::to_string(i % kNames)).c_str(), i);
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  std::map<std::string, int> next;
+  std::vector<std::string> events = Decode(ReadSink());
+  ASSERT_EQ(4U * kEvents, events.size());
+  for (const std::string& event : events) {
+    std::vector<std::string> fields = android::base::Split(event, "|");
+    ASSERT_EQ(4U, fields.size()) << event;
+    int i = next[fields[0]]++;
+    ASSERT_EQ("n" + std::to_string(i % kNames), fields[2]) << event;
+    ASSERT_EQ(i, std::stoi(fields[3])) << event;
+  }
+}
+
+TEST_F(TraceDevBinaryTest, new_sink_starts_afresh) {
+  atrace_int_body("counter", 1);
+  std::string first = ReadSink();
+
+  TemporaryFile second;
+  ASSERT_EQ(0, atrace_set_binary_fd(second.fd));
+  atrace_int_body("counter", 2);
+  atrace_flush();
+  std::string contents;
+  lseek(second.fd, 0, SEEK_SET);
+  ASSERT_TRUE(android::base::ReadFdToString(second.fd, &contents));
+
+  // The second sink decodes on its own: the name is defined again.
+  std::string prefix = android::base::StringPrintf("%d:C|%d|counter|", gettid(), getpid());
+  EXPECT_EQ(std::vector<std::string>{prefix + "1"}, Decode(first));
+  EXPECT_EQ(std::vector<std::string>{prefix + "2"}, Decode(contents));
+}
+
+TEST_F(TraceDevBinaryTest, truncated_input) {
+  atrace_begin_body("fake_name");
+  atrace_end_body();
+  std::string binary = ReadSink();
+
+  std::string text;
+  EXPECT_FALSE(atrace_binary_to_systrace(binary.substr(0, binary.size() - 1), &text));
+  EXPECT_FALSE(atrace_binary_to_systrace("not a trace", &text));
+}
@@ -30,6 +30,9 @@ void atrace_async_begin_body(const char* /*name*/, int32_t /*cookie*/) {}
 void atrace_async_end_body(const char* /*name*/, int32_t /*cookie*/) {}
 void atrace_int_body(const char* /*name*/, int32_t /*value*/) {}
 void atrace_int64_body(const char* /*name*/, int64_t /*value*/) {}
+int atrace_set_buffered_fd(int /*fd*/) { return 0; }
+int atrace_set_binary_fd(int /*fd*/) { return 0; }
+void atrace_flush() {}
 void atrace_init() {}
 uint64_t atrace_get_enabled_tags()
 {
@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cutils/trace.h>
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <mutex>
+
+#include <android-base/logging.h>
+#include <benchmark/benchmark.h>
+
+// The *_body functions are what ATRACE_BEGIN/ATRACE_END call once the tag is
+// enabled, so calling them directly measures the per-event cost without
+// needing tracing to be turned on. trace.h only declares them inside the
+// inline wrappers.
+extern "C" {
+void atrace_begin_body(const char*);
+void atrace_end_body();
+void atrace_int_body(const char*, int32_t);
+}
+
+typedef int (*SetSinkFn)(int fd);
+
+// The buffered sinks write to a real file, so the benchmarks can also report
+// how many bytes each event takes.
+static int StartBufferedSink(SetSinkFn set_sink) {
+    FILE* file = tmpfile();
+    CHECK(file != nullptr);
+    int fd = dup(fileno(file));
+    fclose(file);
+    CHECK_EQ(0, set_sink(fd));
+    return fd;
+}
+
+static void StopBufferedSink(benchmark::State& state, int fd, int64_t events) {
+    atrace_set_buffered_fd(-1);
+    struct stat st;
+    CHECK_EQ(0, fstat(fd, &st));
+    close(fd);
+    state.counters["bytes_per_event"] = static_cast<double>(st.st_size) / events;
+}
+
+static int OpenSink() {
+    // Prefer the real trace_marker, so the direct path pays the real write cost.
+    int fd = open("/sys/kernel/tracing/trace_marker", O_WRONLY | O_CLOEXEC);
+    if (fd == -1) fd = open("/sys/kernel/debug/tracing/trace_marker", O_WRONLY | O_CLOEXEC);
+    if (fd == -1) fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    CHECK_NE(-1, fd);
+    return fd;
+}
+
+static void BM_atrace_begin_end_direct(benchmark::State& state) {
+    int saved_fd = atrace_marker_fd;
+    atrace_marker_fd = OpenSink();
+    while (state.KeepRunning()) {
+        atrace_begin_body("BM_atrace_begin_end");
+        atrace_end_body();
+    }
+    close(atrace_marker_fd);
+    atrace_marker_fd = saved_fd;
+    state.SetItemsProcessed(state.iterations() * 2);
+}
+BENCHMARK(BM_atrace_begin_end_direct)->ThreadRange(1, 8)->UseRealTime();
+
+static void BM_atrace_begin_end_buffered(benchmark::State& state, SetSinkFn set_sink) {
+    // The first thread in sets up the shared sink and the last one out
+    // reports on it.
+    static std::mutex lock;
+    static int users, fd;
+    static int64_t events;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (users++ == 0) fd = StartBufferedSink(set_sink);
+    }
+    while (state.KeepRunning()) {
+        atrace_begin_body("BM_atrace_begin_end");
+        atrace_end_body();
+    }
+    state.SetItemsProcessed(state.iterations() * 2);
+    std::lock_guard<std::mutex> guard(lock);
+    events += state.iterations() * 2;
+    if (--users == 0) {
+        StopBufferedSink(state, fd, events);
+        events = 0;
+    }
+}
+BENCHMARK_CAPTURE(BM_atrace_begin_end_buffered, text, atrace_set_buffered_fd)
+        ->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK_CAPTURE(BM_atrace_begin_end_buffered, binary, atrace_set_binary_fd)
+        ->ThreadRange(1, 8)->UseRealTime();
+
+static void BM_atrace_int_direct(benchmark::State& state) {
+    int saved_fd = atrace_marker_fd;
+    atrace_marker_fd = OpenSink();
+    int32_t value = 0;
+    while (state.KeepRunning()) {
+        atrace_int_body("BM_atrace_int", value++);
+    }
+    close(atrace_marker_fd);
+    atrace_marker_fd = saved_fd;
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_atrace_int_direct);
+
+static void BM_atrace_int_buffered(benchmark::State& state, SetSinkFn set_sink) {
+    int fd = StartBufferedSink(set_sink);
+    int32_t value = 0;
+    while (state.KeepRunning()) {
+        atrace_int_body("BM_atrace_int", value++);
+    }
+    StopBufferedSink(state, fd, state.iterations());
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_CAPTURE(BM_atrace_int_buffered, text, atrace_set_buffered_fd);
+BENCHMARK_CAPTURE(BM_atrace_int_buffered, binary, atrace_set_binary_fd);
+
+BENCHMARK_MAIN();
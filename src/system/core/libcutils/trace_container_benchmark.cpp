@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sys/socket.h>
+
+#include <mutex>
+#include <thread>
+
+#include <android-base/logging.h>
+#include <benchmark/benchmark.h>
+
+#include "../trace-container.cpp"
+
+// Stands in for the container's trace service: a SOCK_SEQPACKET peer that
+// reads and discards every event. It is shared by every benchmark.
+static void StartServer() {
+    static std::once_flag once;
+    std::call_once(once, []() {
+        int fds[2];
+        CHECK_EQ(0, socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds));
+        std::thread([fd = fds[1]]() {
+            char buf[CONTAINER_ATRACE_MESSAGE_LENGTH];
+            while (TEMP_FAILURE_RETRY(recv(fd, buf, sizeof(buf), 0)) > 0) {
+            }
+        }).detach();
+        atrace_use_container_sock = true;
+        atomic_store(&atrace_container_sock_fd, fds[0]);
+    });
+}
+
+// What every event used to cost: the socket guarded by a shared rwlock.
+static pthread_rwlock_t gRwlock = PTHREAD_RWLOCK_INITIALIZER;
+
+static void BM_container_trace_rwlock(benchmark::State& state) {
+    StartServer();
+    int fd = atomic_load(&atrace_container_sock_fd);
+    while (state.KeepRunning()) {
+        pthread_rwlock_rdlock(&gRwlock);
+        WRITE_MSG_IN_CONTAINER_FD(fd, "C", "|", "|%" PRId32, "BM_container_trace", 1);
+        pthread_rwlock_unlock(&gRwlock);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_container_trace_rwlock)->ThreadRange(1, 16)->UseRealTime();
+
+static void BM_container_trace(benchmark::State& state) {
+    StartServer();
+    while (state.KeepRunning()) {
+        atrace_int_body("BM_container_trace", 1);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_container_trace)->ThreadRange(1, 16)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -17,6 +17,7 @@
 #include <cutils/uevent.h>
 
 #include <errno.h>
+#include <limits.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
@@ -50,22 +51,16 @@ ssize_t uevent_kernel_multicast_uid_recv(int socket, void* buffer, size_t length
     return uevent_kernel_recv(socket, buffer, length, true, uid);
 }
 
-ssize_t uevent_kernel_recv(int socket, void* buffer, size_t length, bool require_group, uid_t* uid) {
-    struct iovec iov = {buffer, length};
-    struct sockaddr_nl addr;
-    char control[CMSG_SPACE(sizeof(struct ucred))];
-    struct msghdr hdr = {
-        &addr, sizeof(addr), &iov, 1, control, sizeof(control), 0,
-    };
+/**
+ * Checks that a received message came from the kernel, setting *uid to its
+ * sender's uid. Returns false, having cleared the message, if it didn't.
+ */
+static bool uevent_check_sender(const struct msghdr* hdr, const struct sockaddr_nl* addr,
+                                bool require_group, uid_t* uid) {
     struct ucred* cred;
 
     *uid = -1;
-    ssize_t n = TEMP_FAILURE_RETRY(recvmsg(socket, &hdr, 0));
-    if (n <= 0) {
-        return n;
-    }
-
-    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&hdr);
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(hdr);
     if (cmsg == NULL || cmsg->cmsg_type != SCM_CREDENTIALS) {
         /* ignoring netlink message with no sender credentials */
         goto out;
@@ -74,22 +69,152 @@ ssize_t uevent_kernel_recv(int socket, void* buffer, size_t length, bool require
     cred = (struct ucred*)CMSG_DATA(cmsg);
     *uid = cred->uid;
 
-    if (addr.nl_pid != 0) {
+    if (addr->nl_pid != 0) {
         /* ignore non-kernel */
         goto out;
     }
-    if (require_group && addr.nl_groups == 0) {
+    if (require_group && addr->nl_groups == 0) {
         /* ignore unicast messages when requested */
         goto out;
     }
 
-    return n;
+    return true;
 
 out:
     /* clear residual potentially malicious data */
-    bzero(buffer, length);
-    errno = EIO;
-    return -1;
+    bzero(hdr->msg_iov->iov_base, hdr->msg_iov->iov_len);
+    return false;
+}
+
+ssize_t uevent_kernel_recv(int socket, void* buffer, size_t length, bool require_group, uid_t* uid) {
+    struct iovec iov = {buffer, length};
+    struct sockaddr_nl addr = {};
+    char control[CMSG_SPACE(sizeof(struct ucred))];
+    struct msghdr hdr = {
+        &addr, sizeof(addr), &iov, 1, control, sizeof(control), 0,
+    };
+
+    *uid = -1;
+    ssize_t n = TEMP_FAILURE_RETRY(recvmsg(socket, &hdr, 0));
+    if (n <= 0) {
+        return n;
+    }
+
+    if (!uevent_check_sender(&hdr, &addr, require_group, uid)) {
+        errno = EIO;
+        return -1;
+    }
+    return n;
+}
+
+int uevent_kernel_recv_batch(int socket, struct uevent_msg* msgs, size_t count,
+                             bool require_group) {
+    struct mmsghdr hdrs[UEVENT_BATCH_MAX];
+    struct iovec iovs[UEVENT_BATCH_MAX];
+    struct sockaddr_nl addrs[UEVENT_BATCH_MAX];
+    union {
+        char buf[CMSG_SPACE(sizeof(struct ucred))];
+        struct cmsghdr align;
+    } controls[UEVENT_BATCH_MAX];
+
+    if (count > UEVENT_BATCH_MAX) {
+        count = UEVENT_BATCH_MAX;
+    }
+    for (size_t i = 0; i < count; i++) {
+        iovs[i] = {msgs[i].buffer, msgs[i].length};
+        memset(&addrs[i], 0, sizeof(addrs[i]));
+        hdrs[i].msg_hdr = {
+            &addrs[i], sizeof(addrs[i]), &iovs[i], 1, controls[i].buf, sizeof(controls[i].buf), 0,
+        };
+        hdrs[i].msg_len = 0;
+    }
+
+    int n = TEMP_FAILURE_RETRY(recvmmsg(socket, hdrs, count, MSG_WAITFORONE, nullptr));
+    if (n <= 0) {
+        return n;
+    }
+
+    for (int i = 0; i < n; i++) {
+        msgs[i].received = hdrs[i].msg_len;
+        if (!uevent_check_sender(&hdrs[i].msg_hdr, &addrs[i], require_group, &msgs[i].uid)) {
+            msgs[i].received = -1;
+        }
+    }
+    return n;
+}
+
+bool uevent_next_field(const char* msg, size_t len, size_t* pos, struct uevent_str* key,
+                       struct uevent_str* value) {
+    while (*pos < len) {
+        const char* field = msg + *pos;
+        const char* end = static_cast<const char*>(memchr(field, '\0', len - *pos));
+        size_t field_len = end ? end - field : len - *pos;
+        *pos += field_len + 1;
+
+        const char* eq = static_cast<const char*>(memchr(field, '=', field_len));
+        /* The "action@devpath" line, or anything else without a value */
+        if (eq == NULL) continue;
+
+        key->data = field;
+        key->len = eq - field;
+        value->data = eq + 1;
+        value->len = field + field_len - value->data;
+        return true;
+    }
+    return false;
+}
+
+static long long uevent_parse_number(const struct uevent_str* value) {
+    long long n = 0;
+    if (value->len == 0) return -1;
+    for (size_t i = 0; i < value->len; i++) {
+        char c = value->data[i];
+        if (c < '0' || c > '9' || n > (LLONG_MAX - 9) / 10) return -1;
+        n = n * 10 + (c - '0');
+    }
+    return n;
+}
+
+void uevent_parse(const char* msg, size_t len, struct uevent_fields* fields) {
+    static const struct uevent_str empty = {"", 0};
+    struct uevent_str key, value;
+    size_t pos = 0;
+
+    fields->action = fields->devpath = fields->subsystem = fields->devname = fields->devtype =
+            fields->driver = fields->firmware = fields->modalias = fields->partname = empty;
+    fields->major = fields->minor = fields->partn = -1;
+    fields->seqnum = -1;
+
+#define UEVENT_KEY_IS(name) (key.len == sizeof(name) - 1 && memcmp(key.data, name, key.len) == 0)
+    while (uevent_next_field(msg, len, &pos, &key, &value)) {
+        /* Switch on the length first, so most keys need a single memcmp. */
+        switch (key.len) {
+            case 5:
+                if (UEVENT_KEY_IS("MAJOR")) fields->major = uevent_parse_number(&value);
+                else if (UEVENT_KEY_IS("MINOR")) fields->minor = uevent_parse_number(&value);
+                else if (UEVENT_KEY_IS("PARTN")) fields->partn = uevent_parse_number(&value);
+                break;
+            case 6:
+                if (UEVENT_KEY_IS("ACTION")) fields->action = value;
+                else if (UEVENT_KEY_IS("DRIVER")) fields->driver = value;
+                else if (UEVENT_KEY_IS("SEQNUM")) fields->seqnum = uevent_parse_number(&value);
+                break;
+            case 7:
+                if (UEVENT_KEY_IS("DEVPATH")) fields->devpath = value;
+                else if (UEVENT_KEY_IS("DEVNAME")) fields->devname = value;
+                else if (UEVENT_KEY_IS("DEVTYPE")) fields->devtype = value;
+                break;
+            case 8:
+                if (UEVENT_KEY_IS("FIRMWARE")) fields->firmware = value;
+                else if (UEVENT_KEY_IS("MODALIAS")) fields->modalias = value;
+                else if (UEVENT_KEY_IS("PARTNAME")) fields->partname = value;
+                break;
+            case 9:
+                if (UEVENT_KEY_IS("SUBSYSTEM")) fields->subsystem = value;
+                break;
+        }
+    }
+#undef UEVENT_KEY_IS
 }
 
 int uevent_open_socket(int buf_sz, bool passcred) {
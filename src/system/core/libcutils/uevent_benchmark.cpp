@@ -0,0 +1,225 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cutils/uevent.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include <android-base/logging.h>
+#include <android-base/macros.h>
+#include <android-base/unique_fd.h>
+#include <benchmark/benchmark.h>
+
+using android::base::unique_fd;
+
+#define UEVENT(header, fields) header "\0" fields
+
+// Uevents captured during coldboot on a phone, as the kernel sends them.
+static const std::string kCaptured[] = {
+        std::string(UEVENT("add@/devices/platform/soc/1d84000.ufshc/host0/target0:0:0/0:0:0:0/"
+                           "block/sda/sda1",
+                           "ACTION=add\0"
+                           "DEVPATH=/devices/platform/soc/1d84000.ufshc/host0/target0:0:0/"
+                           "0:0:0:0/block/sda/sda1\0"
+                           "SUBSYSTEM=block\0MAJOR=8\0MINOR=1\0DEVNAME=sda1\0"
+                           "DEVTYPE=partition\0PARTN=1\0PARTNAME=persist\0SEQNUM=2417")),
+        std::string(UEVENT("add@/devices/virtual/misc/ashmem",
+                           "ACTION=add\0DEVPATH=/devices/virtual/misc/ashmem\0SUBSYSTEM=misc\0"
+                           "MAJOR=10\0MINOR=58\0DEVNAME=ashmem\0SEQNUM=2418")),
+        std::string(UEVENT("add@/devices/platform/soc/a600000.ssusb/a600000.dwc3/xhci-hcd.0.auto/"
+                           "usb1/1-1",
+                           "ACTION=add\0"
+                           "DEVPATH=/devices/platform/soc/a600000.ssusb/a600000.dwc3/"
+                           "xhci-hcd.0.auto/usb1/1-1\0"
+                           "SUBSYSTEM=usb\0MAJOR=189\0MINOR=1\0DEVNAME=bus/usb/001/002\0"
+                           "DEVTYPE=usb_device\0DRIVER=usb\0PRODUCT=18d1/4ee7/440\0TYPE=0/0/0\0"
+                           "BUSNUM=001\0DEVNUM=002\0SEQNUM=2419")),
+        std::string(UEVENT("add@/devices/platform/soc/soc:gpio_keys/input/input2/event2",
+                           "ACTION=add\0"
+                           "DEVPATH=/devices/platform/soc/soc:gpio_keys/input/input2/event2\0"
+                           "SUBSYSTEM=input\0MAJOR=13\0MINOR=66\0DEVNAME=input/event2\0"
+                           "SEQNUM=2420")),
+        std::string(UEVENT("change@/devices/platform/soc/soc:qcom,pmic_glink/"
+                           "power_supply/battery",
+                           "ACTION=change\0"
+                           "DEVPATH=/devices/platform/soc/soc:qcom,pmic_glink/"
+                           "power_supply/battery\0"
+                           "SUBSYSTEM=power_supply\0POWER_SUPPLY_NAME=battery\0"
+                           "POWER_SUPPLY_TYPE=Battery\0POWER_SUPPLY_STATUS=Charging\0"
+                           "POWER_SUPPLY_HEALTH=Good\0POWER_SUPPLY_PRESENT=1\0"
+                           "POWER_SUPPLY_CAPACITY=87\0SEQNUM=2421")),
+        std::string(UEVENT("add@/devices/platform/soc/5c00000.qcom,ipa/firmware/ipa_fws.mdt",
+                           "ACTION=add\0"
+                           "DEVPATH=/devices/platform/soc/5c00000.qcom,ipa/firmware/ipa_fws.mdt\0"
+                           "SUBSYSTEM=firmware\0FIRMWARE=ipa_fws.mdt\0TIMEOUT=60\0ASYNC=1\0"
+                           "SEQNUM=2422")),
+        std::string(UEVENT("bind@/devices/platform/soc/c440000.qcom,spmi",
+                           "ACTION=bind\0DEVPATH=/devices/platform/soc/c440000.qcom,spmi\0"
+                           "SUBSYSTEM=platform\0DRIVER=spmi-pmic-arb\0OF_NAME=qcom,spmi\0"
+                           "OF_FULLNAME=/soc/qcom,spmi@c440000\0"
+                           "OF_COMPATIBLE_0=qcom,spmi-pmic-arb\0OF_COMPATIBLE_N=1\0"
+                           "MODALIAS=of:Nqcom,spmiT(null)Cqcom,spmi-pmic-arb\0SEQNUM=2423")),
+};
+
+// Replays the captured uevents over a socketpair in bursts, the way the
+// kernel queues them up during coldboot or a USB storm.
+static constexpr size_t kBurst = 256;
+
+class Replay {
+  public:
+    Replay() {
+        int fds[2];
+        CHECK_EQ(0, socketpair(AF_UNIX, SOCK_DGRAM, 0, fds));
+        reader_.reset(fds[0]);
+        writer_.reset(fds[1]);
+        int on = 1;
+        CHECK_EQ(0, setsockopt(reader_, SOL_SOCKET, SO_PASSCRED, &on, sizeof(on)));
+        int size = 4 * 1024 * 1024;
+        setsockopt(writer_, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+    }
+
+    void SendBurst() {
+        for (size_t i = 0; i < kBurst; i++) {
+            const std::string& msg = kCaptured[next_++ % arraysize(kCaptured)];
+            CHECK_EQ(static_cast<ssize_t>(msg.size()), send(writer_, msg.data(), msg.size(), 0));
+        }
+    }
+
+    int fd() const { return reader_; }
+
+  private:
+    unique_fd reader_;
+    unique_fd writer_;
+    size_t next_ = 0;
+};
+
+static void BM_uevent_recv(benchmark::State& state) {
+    Replay replay;
+    char buffer[2048];
+    uid_t uid;
+    while (state.KeepRunning()) {
+        state.PauseTiming();
+        replay.SendBurst();
+        state.ResumeTiming();
+        for (size_t i = 0; i < kBurst; i++) {
+            // A socketpair has no netlink address, so don't ask for the group check.
+            CHECK_GT(uevent_kernel_recv(replay.fd(), buffer, sizeof(buffer), false, &uid), 0);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kBurst);
+}
+BENCHMARK(BM_uevent_recv);
+
+static void BM_uevent_recv_batch(benchmark::State& state) {
+    Replay replay;
+    const size_t batch = state.range(0);
+    std::vector<char> buffers(batch * 2048);
+    std::vector<uevent_msg> msgs(batch);
+    for (size_t i = 0; i < batch; i++) {
+        msgs[i].buffer = &buffers[i * 2048];
+        msgs[i].length = 2048;
+    }
+    while (state.KeepRunning()) {
+        state.PauseTiming();
+        replay.SendBurst();
+        state.ResumeTiming();
+        for (size_t received = 0; received < kBurst;) {
+            int n = uevent_kernel_recv_batch(replay.fd(), msgs.data(), batch, false);
+            CHECK_GT(n, 0);
+            received += n;
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kBurst);
+}
+BENCHMARK(BM_uevent_recv_batch)->Arg(8)->Arg(UEVENT_BATCH_MAX);
+
+// The way ueventd picks the fields out: a strncmp per known key, copying the
+// values into strings.
+struct CopiedUevent {
+    std::string action, path, subsystem, firmware, partition_name, device_name, modalias;
+    int partition_num, major, minor;
+};
+
+static void ParseByCopying(const char* msg, CopiedUevent* uevent) {
+    uevent->partition_num = uevent->major = uevent->minor = -1;
+    uevent->action.clear();
+    uevent->path.clear();
+    uevent->subsystem.clear();
+    uevent->firmware.clear();
+    uevent->partition_name.clear();
+    uevent->device_name.clear();
+    uevent->modalias.clear();
+    while (*msg) {
+        if (!strncmp(msg, "ACTION=", 7)) {
+            uevent->action = msg + 7;
+        } else if (!strncmp(msg, "DEVPATH=", 8)) {
+            uevent->path = msg + 8;
+        } else if (!strncmp(msg, "SUBSYSTEM=", 10)) {
+            uevent->subsystem = msg + 10;
+        } else if (!strncmp(msg, "FIRMWARE=", 9)) {
+            uevent->firmware = msg + 9;
+        } else if (!strncmp(msg, "MAJOR=", 6)) {
+            uevent->major = atoi(msg + 6);
+        } else if (!strncmp(msg, "MINOR=", 6)) {
+            uevent->minor = atoi(msg + 6);
+        } else if (!strncmp(msg, "PARTN=", 6)) {
+            uevent->partition_num = atoi(msg + 6);
+        } else if (!strncmp(msg, "PARTNAME=", 9)) {
+            uevent->partition_name = msg + 9;
+        } else if (!strncmp(msg, "DEVNAME=", 8)) {
+            uevent->device_name = msg + 8;
+        } else if (!strncmp(msg, "MODALIAS=", 9)) {
+            uevent->modalias = msg + 9;
+        }
+        // advance to after the next \0
+        while (*msg++) {
+        }
+    }
+}
+
+static void BM_uevent_parse_copying(benchmark::State& state) {
+    std::vector<std::string> msgs;
+    for (const std::string& msg : kCaptured) msgs.push_back(msg + std::string(2, '\0'));
+    CopiedUevent uevent;
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        ParseByCopying(msgs[i].c_str(), &uevent);
+        benchmark::DoNotOptimize(uevent.major);
+        if (++i == msgs.size()) i = 0;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_uevent_parse_copying);
+
+static void BM_uevent_parse(benchmark::State& state) {
+    uevent_fields fields;
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        uevent_parse(kCaptured[i].data(), kCaptured[i].size(), &fields);
+        benchmark::DoNotOptimize(fields.major);
+        if (++i == arraysize(kCaptured)) i = 0;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_uevent_parse);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cutils/uevent.h>
+
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+
+#include <android-base/unique_fd.h>
+#include <gtest/gtest.h>
+
+using android::base::unique_fd;
+
+static const char kAddBlock[] =
+        "add@/devices/platform/soc/1d84000.ufshc/host0/target0:0:0/0:0:0:0/block/sda/sda1\0"
+        "ACTION=add\0"
+        "DEVPATH=/devices/platform/soc/1d84000.ufshc/host0/target0:0:0/0:0:0:0/block/sda/sda1\0"
+        "SUBSYSTEM=block\0"
+        "MAJOR=8\0"
+        "MINOR=1\0"
+        "DEVNAME=sda1\0"
+        "DEVTYPE=partition\0"
+        "PARTN=1\0"
+        "PARTNAME=persist\0"
+        "SEQNUM=2417\0";
+
+static std::string S(const uevent_str& str) {
+    return std::string(str.data, str.len);
+}
+
+TEST(uevent, parse) {
+    uevent_fields fields;
+    uevent_parse(kAddBlock, sizeof(kAddBlock) - 1, &fields);
+    EXPECT_EQ("add", S(fields.action));
+    EXPECT_EQ("/devices/platform/soc/1d84000.ufshc/host0/target0:0:0/0:0:0:0/block/sda/sda1",
+              S(fields.devpath));
+    EXPECT_EQ("block", S(fields.subsystem));
+    EXPECT_EQ("sda1", S(fields.devname));
+    EXPECT_EQ("partition", S(fields.devtype));
+    EXPECT_EQ("persist", S(fields.partname));
+    EXPECT_EQ("", S(fields.firmware));
+    EXPECT_EQ(8, fields.major);
+    EXPECT_EQ(1, fields.minor);
+    EXPECT_EQ(1, fields.partn);
+    EXPECT_EQ(2417, fields.seqnum);
+}
+
+TEST(uevent, parse_truncated) {
+    // Cut off after the MAJOR field's value, with no NUL after it.
+    std::string msg(kAddBlock, sizeof(kAddBlock) - 1);
+    msg.resize(msg.find("MAJOR=8") + 7);
+    uevent_fields fields;
+    uevent_parse(msg.data(), msg.size(), &fields);
+    EXPECT_EQ("block", S(fields.subsystem));
+    EXPECT_EQ(8, fields.major);
+    EXPECT_EQ(-1, fields.minor);
+    EXPECT_EQ("", S(fields.devname));
+}
+
+TEST(uevent, next_field) {
+    static const char kMsg[] = "change@/x\0A=1\0NOVALUE\0B=\0C=x=y";
+    size_t pos = 0;
+    uevent_str key, value;
+    std::string fields;
+    while (uevent_next_field(kMsg, sizeof(kMsg) - 1, &pos, &key, &value)) {
+        fields += S(key) + ":" + S(value) + ";";
+    }
+    EXPECT_EQ("A:1;B:;C:x=y;", fields);
+}
+
+TEST(uevent, recv_batch) {
+    int fds[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_DGRAM, 0, fds));
+    unique_fd reader(fds[0]);
+    unique_fd writer(fds[1]);
+    int on = 1;
+    ASSERT_EQ(0, setsockopt(reader, SOL_SOCKET, SO_PASSCRED, &on, sizeof(on)));
+
+    for (int i = 0; i < 3; i++) {
+        ASSERT_EQ(static_cast<ssize_t>(sizeof(kAddBlock)),
+                  send(writer, kAddBlock, sizeof(kAddBlock), 0));
+    }
+
+    char buffers[4][1024];
+    uevent_msg msgs[4];
+    for (int i = 0; i < 4; i++) {
+        msgs[i].buffer = buffers[i];
+        msgs[i].length = sizeof(buffers[i]);
+    }
+
+    // A socketpair has no netlink address, so the messages only pass without
+    // the multicast group check.
+    ASSERT_EQ(2, uevent_kernel_recv_batch(reader, msgs, 2, false));
+    for (int i = 0; i < 2; i++) {
+        EXPECT_EQ(static_cast<ssize_t>(sizeof(kAddBlock)), msgs[i].received);
+        EXPECT_EQ(getuid(), msgs[i].uid);
+        EXPECT_EQ(0, memcmp(buffers[i], kAddBlock, sizeof(kAddBlock)));
+    }
+
+    ASSERT_EQ(1, uevent_kernel_recv_batch(reader, msgs, 4, true));
+    EXPECT_EQ(-1, msgs[0].received);
+    EXPECT_EQ(getuid(), msgs[0].uid);
+    EXPECT_EQ(std::string(sizeof(buffers[0]), '\0'), std::string(buffers[0], sizeof(buffers[0])));
+}
@@ -17,6 +17,8 @@
 
 #pragma once
 
+#include <stddef.h>
+
 /*
  * Run a command while logging its stdout and stderr
  *
@@ -39,7 +41,8 @@
  *           and can be OR'ed together to log to multiple places.
  *   abbreviated: If true, capture up to the first 100 lines and last 4K of
  *           output from the child.  The abbreviated output is not dumped to
- *           the specified log until the child has exited.
+ *           the specified log until the child has exited.  The sizes kept
+ *           can be changed with logwrap_fork_execvp_ext().
  *   file_path: if log_target has the LOG_FILE bit set, then this parameter
  *           must be set to the pathname of the file to log to.
  *
@@ -59,3 +62,70 @@
 
 int logwrap_fork_execvp(int argc, const char* const* argv, int* status, bool forward_signals,
                         int log_target, bool abbreviated, const char* file_path);
+
+/* Values for the flags field of struct logwrap_options */
+
+/*
+ * Start the child with posix_spawn() rather than fork(). The child shares the
+ * caller's address space until it execs instead of copying its page tables,
+ * so starting it doesn't get slower as the caller grows. Output capture and
+ * signal forwarding are unchanged. If argv[0] can't be executed the child's
+ * status is that of an exit(127), as with posix_spawn(), rather than the
+ * exit(-1) of the fork() path.
+ */
+#define LOGWRAP_SPAWN   1
+
+/*
+ * Capture the child's stdout and stderr through a pipe rather than a pty.
+ * This saves opening and unlocking a pty pair on every call, but the child
+ * has no controlling tty, so isatty() is false and stdio fully buffers its
+ * output: only use it for children that don't need a tty and whose output
+ * doesn't have to be interleaved line by line. The pool option is ignored.
+ */
+#define LOGWRAP_CAPTURE_PIPE 2
+
+/*
+ * A pool of pre-opened ptys that repeated calls can reuse instead of opening
+ * a new pty pair each time, for callers that run many short commands. A pty
+ * goes back to the pool, with its terminal settings restored, only if no
+ * process still has it open once the child has exited; otherwise it is closed
+ * and the pool opens a new one when it next runs dry. The pool may be shared
+ * by several threads.
+ */
+struct logwrap_pool;
+
+/*
+ * Creates a pool holding up to max_ptys ptys, opening them all up front.
+ * Returns NULL on failure.
+ */
+struct logwrap_pool* logwrap_pool_create(size_t max_ptys);
+
+/* Closes all of the pool's ptys. The pool must not be in use. */
+void logwrap_pool_destroy(struct logwrap_pool* pool);
+
+struct logwrap_options {
+    unsigned flags;
+    /* If not NULL, take the child's pty from this pool. */
+    struct logwrap_pool* pool;
+    /*
+     * With abbreviated output, keep up to this many bytes from the start and
+     * from the end of the output. 0 means the default of 4K.
+     */
+    size_t abbr_head_size;
+    size_t abbr_tail_size;
+    /*
+     * If not NULL, abbr_head_size + abbr_tail_size bytes (after the defaults
+     * are applied) to hold the abbreviated output. Otherwise logwrap uses its
+     * own storage, which takes an allocation only if the sizes add up to more
+     * than the defaults.
+     */
+    char* abbr_storage;
+};
+
+/*
+ * Like logwrap_fork_execvp(), with extra options. options may be NULL, which
+ * is the same as calling logwrap_fork_execvp().
+ */
+int logwrap_fork_execvp_ext(int argc, const char* const* argv, int* status, bool forward_signals,
+                            int log_target, bool abbreviated, const char* file_path,
+                            const struct logwrap_options* options);
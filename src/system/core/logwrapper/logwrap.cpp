@@ -19,12 +19,14 @@
 #include <libgen.h>
 #include <poll.h>
 #include <pthread.h>
+#include <spawn.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <termios.h>
 #include <unistd.h>
 
 #include <algorithm>
@@ -55,14 +57,22 @@ static struct sigaction old_hup;
 
 #define MAX_KLOG_TAG 16
 
+/* Output from the child is read into a buffer of this size and split into
+ * lines in place. Only a trailing partial line is ever moved.
+ */
+#define LINE_BUF_SIZE 0x10000
+
+/* Lines for the Android log are collected into entries of up to this many
+ * bytes, which keeps them well under liblog's maximum payload.
+ */
+#define ALOG_BATCH_SIZE 4000
+
 /* This is a simple buffer that holds up to the first beginning_buf->buf_size
  * bytes of output from a command.
  */
 #define BEGINNING_BUF_SIZE 0x1000
 struct beginning_buf {
     char* buf;
-    size_t alloc_len;
-    /* buf_size is the usable space, which is one less than the allocated size */
     size_t buf_size;
     size_t used_len;
 };
@@ -74,13 +84,11 @@ struct beginning_buf {
 #define ENDING_BUF_SIZE 0x1000
 struct ending_buf {
     char* buf;
-    ssize_t alloc_len;
-    /* buf_size is the usable space, which is one less than the allocated size */
-    ssize_t buf_size;
-    ssize_t used_len;
+    size_t buf_size;
+    size_t used_len;
     /* read and write offsets into the circular buffer */
-    int read;
-    int write;
+    size_t read;
+    size_t write;
 };
 
 /* A structure to hold all the abbreviated buf data */
@@ -88,6 +96,8 @@ struct abbr_buf {
     struct beginning_buf b_buf;
     struct ending_buf e_buf;
     int beginning_buf_full;
+    /* Storage for both bufs, if it had to be allocated */
+    char* allocated;
 };
 
 /* Collect all the various bits of info needed for logging in one place. */
@@ -98,191 +108,283 @@ struct log_info {
     bool abbreviated;
     FILE* fp;
     struct abbr_buf a_buf;
+    /* Storage for the abbreviated output when the default sizes are used */
+    char abbr_storage[BEGINNING_BUF_SIZE + ENDING_BUF_SIZE];
+    /* Lines waiting to be written to the Android log as one entry */
+    char alog_batch[ALOG_BATCH_SIZE];
+    size_t alog_batch_len;
 };
 
 /* Forware declaration */
-static void add_line_to_abbr_buf(struct abbr_buf* a_buf, char* linebuf, int linelen);
+static void add_line_to_abbr_buf(struct abbr_buf* a_buf, const char* line, size_t len);
 
-/* Return 0 on success, and 1 when full */
-static int add_line_to_linear_buf(struct beginning_buf* b_buf, char* line, ssize_t line_len) {
+/* Add a line and its newline. Return 0 on success, and 1 when full */
+static int add_line_to_linear_buf(struct beginning_buf* b_buf, const char* line, size_t len) {
     int full = 0;
 
-    if ((line_len + b_buf->used_len) > b_buf->buf_size) {
+    if ((len + 1 + b_buf->used_len) > b_buf->buf_size) {
         full = 1;
     } else {
         /* Add to the end of the buf */
-        memcpy(b_buf->buf + b_buf->used_len, line, line_len);
-        b_buf->used_len += line_len;
+        memcpy(b_buf->buf + b_buf->used_len, line, len);
+        b_buf->buf[b_buf->used_len + len] = '\n';
+        b_buf->used_len += len + 1;
     }
 
     return full;
 }
 
-static void add_line_to_circular_buf(struct ending_buf* e_buf, char* line, ssize_t line_len) {
-    ssize_t free_len;
-    ssize_t needed_space;
-    int cnt;
-
-    if (e_buf->buf == nullptr) {
-        return;
+/* Copy len bytes in at the write offset, dealing with possible wraparound. */
+static void copy_to_circular_buf(struct ending_buf* e_buf, const char* src, size_t len) {
+    size_t cnt = std::min(len, e_buf->buf_size - e_buf->write);
+    memcpy(e_buf->buf + e_buf->write, src, cnt);
+    if (cnt < len) {
+        memcpy(e_buf->buf, src + cnt, len - cnt);
     }
+    e_buf->write = (e_buf->write + len) % e_buf->buf_size;
+}
 
-    if (line_len > e_buf->buf_size) {
+static void add_line_to_circular_buf(struct ending_buf* e_buf, const char* line, size_t len) {
+    size_t free_len;
+    size_t needed_space;
+
+    if (e_buf->buf_size == 0 || len + 1 > e_buf->buf_size) {
         return;
     }
 
     free_len = e_buf->buf_size - e_buf->used_len;
 
-    if (line_len > free_len) {
+    if (len + 1 > free_len) {
         /* remove oldest entries at read, and move read to make
          * room for the new string */
-        needed_space = line_len - free_len;
+        needed_space = len + 1 - free_len;
         e_buf->read = (e_buf->read + needed_space) % e_buf->buf_size;
         e_buf->used_len -= needed_space;
     }
 
-    /* Copy the line into the circular buffer, dealing with possible
-     * wraparound.
-     */
-    cnt = std::min(line_len, e_buf->buf_size - e_buf->write);
-    memcpy(e_buf->buf + e_buf->write, line, cnt);
-    if (cnt < line_len) {
-        memcpy(e_buf->buf, line + cnt, line_len - cnt);
+    copy_to_circular_buf(e_buf, line, len);
+    copy_to_circular_buf(e_buf, "\n", 1);
+    e_buf->used_len += len + 1;
+}
+
+/* Write out the lines collected for the Android log */
+static void flush_alog_batch(struct log_info* log_info) {
+    if (log_info->alog_batch_len == 0) {
+        return;
     }
-    e_buf->used_len += line_len;
-    e_buf->write = (e_buf->write + line_len) % e_buf->buf_size;
+    log_info->alog_batch[log_info->alog_batch_len] = '\0';
+    __android_log_write(ANDROID_LOG_INFO, log_info->btag, log_info->alog_batch);
+    log_info->alog_batch_len = 0;
 }
 
-/* Log directly to the specified log */
-static void do_log_line(struct log_info* log_info, const char* line) {
+/* Add a line, which is line followed by line2, to the next Android log entry,
+ * starting a new entry if it doesn't fit. Lines too long for an entry of their
+ * own are logged alone, as they always were.
+ */
+static void add_line_to_alog_batch(struct log_info* log_info, const char* line, size_t len,
+                                   const char* line2, size_t len2) {
+    if (len2 > 0 && line2[len2 - 1] == '\n') {
+        len2--;
+    } else if (len2 == 0 && len > 0 && line[len - 1] == '\n') {
+        len--;
+    }
+    if (log_info->alog_batch_len + 1 + len + len2 >= ALOG_BATCH_SIZE) {
+        flush_alog_batch(log_info);
+        if (len + len2 + 1 >= ALOG_BATCH_SIZE) {
+            ALOG(LOG_INFO, log_info->btag, "%.*s%.*s", static_cast<int>(len), line,
+                 static_cast<int>(len2), line2);
+            return;
+        }
+    }
+    if (log_info->alog_batch_len > 0) {
+        log_info->alog_batch[log_info->alog_batch_len++] = '\n';
+    }
+    memcpy(log_info->alog_batch + log_info->alog_batch_len, line, len);
+    memcpy(log_info->alog_batch + log_info->alog_batch_len + len, line2, len2);
+    log_info->alog_batch_len += len + len2;
+}
+
+/* Log directly to the specified log. The line is line[0, len) followed by
+ * line2[0, len2), which lets a line that wraps around the end of a circular
+ * buffer be logged where it is. Neither needs to be NUL terminated.
+ */
+static void do_log_line(struct log_info* log_info, const char* line, size_t len,
+                        const char* line2 = "", size_t len2 = 0) {
     if (log_info->log_target & LOG_KLOG) {
-        klog_write(6, log_info->klog_fmt, line);
+        /* The kernel makes each write one record, so lines can't be batched */
+        klog_write(6, log_info->klog_fmt, static_cast<int>(len), line, static_cast<int>(len2),
+                   line2);
     }
     if (log_info->log_target & LOG_ALOG) {
-        ALOG(LOG_INFO, log_info->btag, "%s", line);
+        add_line_to_alog_batch(log_info, line, len, line2, len2);
     }
     if (log_info->log_target & LOG_FILE) {
-        fprintf(log_info->fp, "%s\n", line);
+        fwrite(line, 1, len, log_info->fp);
+        fwrite(line2, 1, len2, log_info->fp);
+        fputc('\n', log_info->fp);
     }
 }
 
+static void do_log_line(struct log_info* log_info, const char* line) {
+    do_log_line(log_info, line, strlen(line));
+}
+
 /* Log to either the abbreviated buf, or directly to the specified log
- * via do_log_line() above.
+ * via do_log_line() above. line is one line of output without its newline,
+ * and is NUL terminated at len.
  */
-static void log_line(struct log_info* log_info, char* line, int len) {
+static void log_line(struct log_info* log_info, char* line, size_t len) {
     if (log_info->abbreviated) {
+        /* The abbreviated logging code uses newline as the line separator, and
+         * adds one to each line itself, so drop the CR the pty layer puts
+         * before it and turn any others into line breaks. Output captured
+         * through a pipe has no CR to drop.
+         */
+        if (len > 0 && line[len - 1] == '\r') {
+            len--;
+        }
+        for (char* cr = line; (cr = static_cast<char*>(memchr(cr, '\r', line + len - cr)));) {
+            *cr++ = '\n';
+        }
         add_line_to_abbr_buf(&log_info->a_buf, line, len);
     } else {
-        do_log_line(log_info, line);
+        /* Log up to the first CR (or NUL), dropping the one the pty adds */
+        len = strnlen(line, len);
+        char* cr = static_cast<char*>(memchr(line, '\r', len));
+        if (cr) {
+            *cr = '\0';
+            len = cr - line;
+        }
+        do_log_line(log_info, line, len);
     }
 }
 
+/* Log every complete line in buf[0, len), and return the number of bytes
+ * consumed. A trailing partial line is left for the next read unless the
+ * buffer is full, in which case it is logged as it is. buf must have room
+ * for a NUL at buf[len].
+ */
+static size_t log_lines(struct log_info* log_info, char* buf, size_t len, bool full) {
+    char* start = buf;
+    char* end = buf + len;
+    char* nl;
+    while ((nl = static_cast<char*>(memchr(start, '\n', end - start)))) {
+        *nl = '\0';
+        log_line(log_info, start, nl - start);
+        start = nl + 1;
+    }
+    if (full && start == buf) {
+        *end = '\0';
+        log_line(log_info, start, end - start);
+        start = end;
+    }
+    return start - buf;
+}
+
 /*
  * The kernel will take a maximum of 1024 bytes in any single write to
  * the kernel logging device file, so find and print each line one at
- * a time.  The allocated size for buf should be at least 1 byte larger
- * than buf_size (the usable size of the buffer) to make sure there is
- * room to temporarily stuff a null byte to terminate a line for logging.
+ * a time. The lines are buf[0, len) followed by buf2[0, len2), so that a
+ * circular buffer can be printed without copying it straight first. Each
+ * line is printed with its newline. A partial last line is ignored.
  */
-static void print_buf_lines(struct log_info* log_info, char* buf, int buf_size) {
-    char* line_start;
-    char c;
-    int i;
-
-    line_start = buf;
-    for (i = 0; i < buf_size; i++) {
-        if (*(buf + i) == '\n') {
-            /* Found a line ending, print the line and compute new line_start */
-            /* Save the next char and replace with \0 */
-            c = *(buf + i + 1);
-            *(buf + i + 1) = '\0';
-            do_log_line(log_info, line_start);
-            /* Restore the saved char */
-            *(buf + i + 1) = c;
-            line_start = buf + i + 1;
-        } else if (*(buf + i) == '\0') {
-            /* The end of the buffer, print the last bit */
-            do_log_line(log_info, line_start);
-            break;
-        }
+static void print_buf_lines(struct log_info* log_info, const char* buf, size_t len,
+                            const char* buf2 = nullptr, size_t len2 = 0) {
+    const char* start = buf;
+    const char* end = buf + len;
+    const char* nl;
+
+    while ((nl = static_cast<const char*>(memchr(start, '\n', end - start)))) {
+        do_log_line(log_info, start, nl + 1 - start);
+        start = nl + 1;
     }
-    /* If the buffer was completely full, and didn't end with a newline, just
-     * ignore the partial last line.
-     */
+    if (len2 == 0) {
+        return;
+    }
+
+    /* The line that wraps around, if any */
+    nl = static_cast<const char*>(memchr(buf2, '\n', len2));
+    if (!nl) {
+        return;
+    }
+    if (start != end) {
+        do_log_line(log_info, start, end - start, buf2, nl + 1 - buf2);
+        start = nl + 1;
+    } else {
+        start = buf2;
+    }
+    print_buf_lines(log_info, start, buf2 + len2 - start);
 }
 
-static void init_abbr_buf(struct abbr_buf* a_buf) {
-    char* new_buf;
+/*
+ * Point the abbreviated bufs at storage for head_size and tail_size bytes:
+ * the caller's if it gave some, log_info's own if the sizes fit, and a
+ * single allocation otherwise.
+ */
+static void init_abbr_buf(struct log_info* log_info, const struct logwrap_options* options) {
+    struct abbr_buf* a_buf = &log_info->a_buf;
+    size_t head_size = BEGINNING_BUF_SIZE;
+    size_t tail_size = ENDING_BUF_SIZE;
+    char* storage = log_info->abbr_storage;
 
     memset(a_buf, 0, sizeof(struct abbr_buf));
-    new_buf = static_cast<char*>(malloc(BEGINNING_BUF_SIZE));
-    if (new_buf) {
-        a_buf->b_buf.buf = new_buf;
-        a_buf->b_buf.alloc_len = BEGINNING_BUF_SIZE;
-        a_buf->b_buf.buf_size = BEGINNING_BUF_SIZE - 1;
-    }
-    new_buf = static_cast<char*>(malloc(ENDING_BUF_SIZE));
-    if (new_buf) {
-        a_buf->e_buf.buf = new_buf;
-        a_buf->e_buf.alloc_len = ENDING_BUF_SIZE;
-        a_buf->e_buf.buf_size = ENDING_BUF_SIZE - 1;
+    if (options) {
+        if (options->abbr_head_size) head_size = options->abbr_head_size;
+        if (options->abbr_tail_size) tail_size = options->abbr_tail_size;
+    }
+    if (options && options->abbr_storage) {
+        storage = options->abbr_storage;
+    } else if (head_size + tail_size > sizeof(log_info->abbr_storage)) {
+        storage = a_buf->allocated = static_cast<char*>(malloc(head_size + tail_size));
+        if (!storage) {
+            return;
+        }
     }
+    a_buf->b_buf.buf = storage;
+    a_buf->b_buf.buf_size = head_size;
+    a_buf->e_buf.buf = storage + head_size;
+    a_buf->e_buf.buf_size = tail_size;
 }
 
 static void free_abbr_buf(struct abbr_buf* a_buf) {
-    free(a_buf->b_buf.buf);
-    free(a_buf->e_buf.buf);
+    free(a_buf->allocated);
 }
 
-static void add_line_to_abbr_buf(struct abbr_buf* a_buf, char* linebuf, int linelen) {
+static void add_line_to_abbr_buf(struct abbr_buf* a_buf, const char* line, size_t len) {
     if (!a_buf->beginning_buf_full) {
-        a_buf->beginning_buf_full = add_line_to_linear_buf(&a_buf->b_buf, linebuf, linelen);
+        a_buf->beginning_buf_full = add_line_to_linear_buf(&a_buf->b_buf, line, len);
     }
     if (a_buf->beginning_buf_full) {
-        add_line_to_circular_buf(&a_buf->e_buf, linebuf, linelen);
+        add_line_to_circular_buf(&a_buf->e_buf, line, len);
     }
 }
 
 static void print_abbr_buf(struct log_info* log_info) {
     struct abbr_buf* a_buf = &log_info->a_buf;
+    struct ending_buf* e_buf = &a_buf->e_buf;
 
     /* Add the abbreviated output to the kernel log */
-    if (a_buf->b_buf.alloc_len) {
-        print_buf_lines(log_info, a_buf->b_buf.buf, a_buf->b_buf.used_len);
-    }
+    print_buf_lines(log_info, a_buf->b_buf.buf, a_buf->b_buf.used_len);
 
     /* Print an ellipsis to indicate that the buffer has wrapped or
      * is full, and some data was not logged.
      */
-    if (a_buf->e_buf.used_len == a_buf->e_buf.buf_size) {
+    if (e_buf->used_len == e_buf->buf_size && e_buf->buf_size != 0) {
         do_log_line(log_info, "...\n");
     }
 
-    if (a_buf->e_buf.used_len == 0) {
+    if (e_buf->used_len == 0) {
         return;
     }
 
-    /* Simplest way to print the circular buffer is allocate a second buf
-     * of the same size, and memcpy it so it's a simple linear buffer,
-     * and then cal print_buf_lines on it */
-    if (a_buf->e_buf.read < a_buf->e_buf.write) {
+    if (e_buf->read < e_buf->write) {
         /* no wrap around, just print it */
-        print_buf_lines(log_info, a_buf->e_buf.buf + a_buf->e_buf.read, a_buf->e_buf.used_len);
+        print_buf_lines(log_info, e_buf->buf + e_buf->read, e_buf->used_len);
     } else {
-        /* The circular buffer will always have at least 1 byte unused,
-         * so by allocating alloc_len here we will have at least
-         * 1 byte of space available as required by print_buf_lines().
-         */
-        char* nbuf = static_cast<char*>(malloc(a_buf->e_buf.alloc_len));
-        if (!nbuf) {
-            return;
-        }
-        int first_chunk_len = a_buf->e_buf.buf_size - a_buf->e_buf.read;
-        memcpy(nbuf, a_buf->e_buf.buf + a_buf->e_buf.read, first_chunk_len);
-        /* copy second chunk */
-        memcpy(nbuf + first_chunk_len, a_buf->e_buf.buf, a_buf->e_buf.write);
-        print_buf_lines(log_info, nbuf, first_chunk_len + a_buf->e_buf.write);
-        free(nbuf);
+        /* Print the two halves in place */
+        size_t first_chunk_len = e_buf->buf_size - e_buf->read;
+        print_buf_lines(log_info, e_buf->buf + e_buf->read, first_chunk_len, e_buf->buf,
+                        e_buf->write);
     }
 }
 
@@ -326,9 +428,10 @@ static void signal_handler(int signal_num) {
 }
 
 static int parent(const char* tag, int parent_read, pid_t pid, int* chld_sts, int log_target,
-                  bool abbreviated, const char* file_path, bool forward_signals) {
+                  bool abbreviated, const char* file_path, bool forward_signals,
+                  const struct logwrap_options* options) {
     int status = 0;
-    char buffer[4096];
+    char* buffer;
     struct pollfd poll_fds[] = {
             {
                     .fd = parent_read,
@@ -340,9 +443,8 @@ static int parent(const char* tag, int parent_read, pid_t pid, int* chld_sts, in
 
     struct log_info log_info;
 
-    int a = 0;  // start index of unprocessed data
-    int b = 0;  // end index of unprocessed data
-    int sz;
+    size_t b = 0;  // end index of unprocessed data, which always starts at 0
+    ssize_t sz;
     bool found_child = false;
     // There is a very small chance that opening child_ptty in the child will fail, but in this case
     // POLLHUP will not be generated below.  Therefore, we use a 1 second timeout for poll() until
@@ -351,6 +453,13 @@ static int parent(const char* tag, int parent_read, pid_t pid, int* chld_sts, in
     bool received_messages = false;
     char tmpbuf[256];
 
+    buffer = static_cast<char*>(malloc(LINE_BUF_SIZE));
+    if (!buffer) {
+        ERROR("Cannot allocate output buffer\n");
+        return -1;
+    }
+    log_info.alog_batch_len = 0;
+
     log_info.btag = basename(tag);
     if (!log_info.btag) {
         log_info.btag = tag;
@@ -360,11 +469,11 @@ static int parent(const char* tag, int parent_read, pid_t pid, int* chld_sts, in
         abbreviated = 0;
     }
     if (abbreviated) {
-        init_abbr_buf(&log_info.a_buf);
+        init_abbr_buf(&log_info, options);
     }
 
     if (log_target & LOG_KLOG) {
-        snprintf(log_info.klog_fmt, sizeof(log_info.klog_fmt), "<6>%.*s: %%s\n", MAX_KLOG_TAG,
+        snprintf(log_info.klog_fmt, sizeof(log_info.klog_fmt), "<6>%.*s: %%.*s%%.*s\n", MAX_KLOG_TAG,
                  log_info.btag);
     }
 
@@ -397,45 +506,19 @@ static int parent(const char* tag, int parent_read, pid_t pid, int* chld_sts, in
 
         if (poll_fds[0].revents & POLLIN) {
             received_messages = true;
-            sz = TEMP_FAILURE_RETRY(read(parent_read, &buffer[b], sizeof(buffer) - 1 - b));
-
-            sz += b;
-            // Log one line at a time
-            for (b = 0; b < sz; b++) {
-                if (buffer[b] == '\r') {
-                    if (abbreviated) {
-                        /* The abbreviated logging code uses newline as
-                         * the line separator.  Lucikly, the pty layer
-                         * helpfully cooks the output of the command
-                         * being run and inserts a CR before NL.  So
-                         * I just change it to NL here when doing
-                         * abbreviated logging.
-                         */
-                        buffer[b] = '\n';
-                    } else {
-                        buffer[b] = '\0';
-                    }
-                } else if (buffer[b] == '\n') {
-                    buffer[b] = '\0';
-                    log_line(&log_info, &buffer[a], b - a);
-                    a = b + 1;
+            // Once the child has hung up, drain everything it left behind rather than only
+            // what fits in one read.
+            do {
+                sz = TEMP_FAILURE_RETRY(read(parent_read, &buffer[b], LINE_BUF_SIZE - 1 - b));
+                if (sz > 0) {
+                    b += sz;
+                    size_t used = log_lines(&log_info, buffer, b, b == LINE_BUF_SIZE - 1);
+                    // Keep left-overs
+                    b -= used;
+                    memmove(buffer, &buffer[used], b);
                 }
-            }
-
-            if (a == 0 && b == sizeof(buffer) - 1) {
-                // buffer is full, flush
-                buffer[b] = '\0';
-                log_line(&log_info, &buffer[a], b - a);
-                b = 0;
-            } else if (a != b) {
-                // Keep left-overs
-                b -= a;
-                memmove(buffer, &buffer[a], b);
-                a = 0;
-            } else {
-                a = 0;
-                b = 0;
-            }
+            } while (sz > 0 && (poll_fds[0].revents & POLLHUP));
+            flush_alog_batch(&log_info);
         }
 
         if (!received_messages || (poll_fds[0].revents & POLLHUP)) {
@@ -480,9 +563,8 @@ static int parent(const char* tag, int parent_read, pid_t pid, int* chld_sts, in
     }
 
     // Flush remaining data
-    if (a != b) {
-        buffer[b] = '\0';
-        log_line(&log_info, &buffer[a], b - a);
+    if (b != 0) {
+        log_lines(&log_info, buffer, b, true);
     }
 
     /* All the output has been processed, time to dump the abbreviated output */
@@ -510,12 +592,14 @@ static int parent(const char* tag, int parent_read, pid_t pid, int* chld_sts, in
 
 err_waitpid:
 err_poll:
+    flush_alog_batch(&log_info);
     if (log_target & LOG_FILE) {
         fclose(log_info.fp); /* Also closes underlying fd */
     }
     if (abbreviated) {
         free_abbr_buf(&log_info.a_buf);
     }
+    free(buffer);
     return rc;
 }
 
@@ -530,12 +614,178 @@ static void child(int argc, const char* const* argv) {
     }
 }
 
+/* One end of a pty pair. */
+struct logwrap_pty {
+    int master;
+    char devname[64];
+    /* The settings the pty was opened with, restored before it is reused. */
+    struct termios tio;
+};
+
+struct logwrap_pool {
+    pthread_mutex_t lock;
+    size_t max_ptys;
+    size_t count;
+    struct logwrap_pty* ptys;
+};
+
+static bool open_pty(struct logwrap_pty* pty) {
+    pty->master = TEMP_FAILURE_RETRY(posix_openpt(O_RDWR | O_CLOEXEC));
+    if (pty->master < 0) {
+        ERROR("Cannot create parent ptty\n");
+        return false;
+    }
+    if (grantpt(pty->master) || unlockpt(pty->master) ||
+        ptsname_r(pty->master, pty->devname, sizeof(pty->devname)) != 0 ||
+        tcgetattr(pty->master, &pty->tio) != 0) {
+        ERROR("Problem with /dev/ptmx\n");
+        close(pty->master);
+        return false;
+    }
+    return true;
+}
+
+struct logwrap_pool* logwrap_pool_create(size_t max_ptys) {
+    struct logwrap_pool* pool =
+            static_cast<struct logwrap_pool*>(calloc(1, sizeof(struct logwrap_pool)));
+    if (!pool) {
+        return nullptr;
+    }
+    pool->ptys = static_cast<struct logwrap_pty*>(calloc(max_ptys, sizeof(struct logwrap_pty)));
+    if (max_ptys && !pool->ptys) {
+        free(pool);
+        return nullptr;
+    }
+    pthread_mutex_init(&pool->lock, nullptr);
+    pool->max_ptys = max_ptys;
+    for (; pool->count < max_ptys; pool->count++) {
+        if (!open_pty(&pool->ptys[pool->count])) {
+            logwrap_pool_destroy(pool);
+            return nullptr;
+        }
+    }
+    return pool;
+}
+
+void logwrap_pool_destroy(struct logwrap_pool* pool) {
+    if (!pool) {
+        return;
+    }
+    for (size_t i = 0; i < pool->count; i++) {
+        close(pool->ptys[i].master);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->ptys);
+    free(pool);
+}
+
+/* Takes a pty from the pool, or opens a new one if the pool is empty. */
+static bool pool_get_pty(struct logwrap_pool* pool, struct logwrap_pty* pty) {
+    pthread_mutex_lock(&pool->lock);
+    bool found = pool->count > 0;
+    if (found) {
+        *pty = pool->ptys[--pool->count];
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return found || open_pty(pty);
+}
+
+/*
+ * Returns a pty to the pool once the child is done with it. A pty that some
+ * process (say, a daemon the child left behind) still has open would hand
+ * that process's output to the next child, so it is closed instead.
+ */
+static void pool_put_pty(struct logwrap_pool* pool, struct logwrap_pty* pty) {
+    struct pollfd pfd = {.fd = pty->master, .events = POLLIN};
+    bool reusable = TEMP_FAILURE_RETRY(poll(&pfd, 1, 0)) == 1 && pfd.revents == POLLHUP &&
+                    tcsetattr(pty->master, TCSANOW, &pty->tio) == 0;
+    if (reusable) {
+        pthread_mutex_lock(&pool->lock);
+        reusable = pool->count < pool->max_ptys;
+        if (reusable) {
+            pool->ptys[pool->count++] = *pty;
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+    if (!reusable) {
+        close(pty->master);
+    }
+}
+
+/*
+ * Start the child with posix_spawnp() instead of fork(). The child gets the
+ * same session, controlling tty, stdout/stderr and signal mask as child()
+ * would set up. Its output goes to child_write if that is a valid fd, and to
+ * the pty child_devname otherwise. Returns the pid, or -1 if the child
+ * couldn't be started.
+ */
+static pid_t spawn_child(int argc, const char* const* argv, const char* child_devname,
+                         int child_write, bool forward_signals, const sigset_t* oldset) {
+    posix_spawnattr_t attr;
+    posix_spawn_file_actions_t file_actions;
+    short flags = POSIX_SPAWN_SETSID;
+#if defined(POSIX_SPAWN_USEVFORK)
+    // Share the parent's address space until exec, so the cost doesn't grow with it.
+    flags |= POSIX_SPAWN_USEVFORK;
+#endif
+    pid_t pid = -1;
+
+    char* argv_child[argc + 1];
+    memcpy(argv_child, argv, argc * sizeof(char*));
+    argv_child[argc] = nullptr;
+
+    if (posix_spawnattr_init(&attr)) {
+        return -1;
+    }
+    if (posix_spawn_file_actions_init(&file_actions)) {
+        posix_spawnattr_destroy(&attr);
+        return -1;
+    }
+    if (forward_signals) {
+        flags |= POSIX_SPAWN_SETSIGMASK;
+        posix_spawnattr_setsigmask(&attr, oldset);
+    }
+    posix_spawnattr_setflags(&attr, flags);
+    if (child_write >= 0) {
+        posix_spawn_file_actions_adddup2(&file_actions, child_write, 1);
+    } else {
+        // Opening the pty after setsid() makes it the controlling tty, as in the fork() path.
+        posix_spawn_file_actions_addopen(&file_actions, 1, child_devname, O_RDWR, 0);
+    }
+    posix_spawn_file_actions_adddup2(&file_actions, 1, 2);
+
+    int err = posix_spawnp(&pid, argv_child[0], &file_actions, &attr, argv_child, environ);
+    if (err) {
+        ERROR("executing %s failed: %s\n", argv_child[0], strerror(err));
+        pid = -1;
+    }
+
+    posix_spawn_file_actions_destroy(&file_actions);
+    posix_spawnattr_destroy(&attr);
+    return pid;
+}
+
 int logwrap_fork_execvp(int argc, const char* const* argv, int* status, bool forward_signals,
                         int log_target, bool abbreviated, const char* file_path) {
+    return logwrap_fork_execvp_ext(argc, argv, status, forward_signals, log_target, abbreviated,
+                                   file_path, nullptr);
+}
+
+int logwrap_fork_execvp_ext(int argc, const char* const* argv, int* status, bool forward_signals,
+                            int log_target, bool abbreviated, const char* file_path,
+                            const struct logwrap_options* options) {
     pid_t pid;
-    int parent_ptty;
+    struct logwrap_pty pty;
+    int parent_read;
+    // The write end of the pipe in LOGWRAP_CAPTURE_PIPE mode.
+    int child_write = -1;
+    // A pooled pty's slave, held open until the child has opened its own.
+    int parent_slave = -1;
     sigset_t oldset;
     int rc = 0;
+    bool use_spawn = options && (options->flags & LOGWRAP_SPAWN);
+    bool use_pipe = options && (options->flags & LOGWRAP_CAPTURE_PIPE);
+    struct logwrap_pool* pool = (options && !use_pipe) ? options->pool : nullptr;
 
     rc = pthread_mutex_lock(&fd_mutex);
     if (rc) {
@@ -543,20 +793,32 @@ int logwrap_fork_execvp(int argc, const char* const* argv, int* status, bool for
         goto err_lock;
     }
 
-    /* Use ptty instead of socketpair so that STDOUT is not buffered */
-    parent_ptty = TEMP_FAILURE_RETRY(posix_openpt(O_RDWR | O_CLOEXEC));
-    if (parent_ptty < 0) {
-        ERROR("Cannot create parent ptty\n");
-        rc = -1;
-        goto err_open;
-    }
-
-    char child_devname[64];
-    if (grantpt(parent_ptty) || unlockpt(parent_ptty) ||
-        ptsname_r(parent_ptty, child_devname, sizeof(child_devname)) != 0) {
-        ERROR("Problem with /dev/ptmx\n");
-        rc = -1;
-        goto err_ptty;
+    if (use_pipe) {
+        int fds[2];
+        if (pipe2(fds, O_CLOEXEC)) {
+            ERROR("Cannot create pipe\n");
+            rc = -1;
+            goto err_open;
+        }
+        parent_read = fds[0];
+        child_write = fds[1];
+    } else {
+        /* Use ptty instead of socketpair so that STDOUT is not buffered */
+        if (!(pool ? pool_get_pty(pool, &pty) : open_pty(&pty))) {
+            rc = -1;
+            goto err_open;
+        }
+        parent_read = pty.master;
+        if (pool) {
+            // A reused pty reports POLLHUP until its slave is opened again, which the child
+            // might not have done by the time parent() first polls.
+            parent_slave = TEMP_FAILURE_RETRY(open(pty.devname, O_RDWR | O_NOCTTY | O_CLOEXEC));
+            if (parent_slave < 0) {
+                ERROR("Cannot open child_ptty: %s\n", strerror(errno));
+                rc = -1;
+                goto err_ptty;
+            }
+        }
     }
 
     if (forward_signals) {
@@ -564,7 +826,20 @@ int logwrap_fork_execvp(int argc, const char* const* argv, int* status, bool for
         block_signals(&oldset);
     }
 
-    pid = fork();
+    if (use_spawn) {
+        pid = spawn_child(argc, argv, pty.devname, child_write, forward_signals, &oldset);
+        if (pid < 0) {
+            // Report it the way bionic's posix_spawn() reports a failed exec.
+            if (status) {
+                *status = W_EXITCODE(127, 0);
+            } else {
+                rc = 127;
+            }
+            goto err_fork;
+        }
+    } else {
+        pid = fork();
+    }
     if (pid < 0) {
         ERROR("Failed to fork\n");
         rc = -1;
@@ -577,25 +852,38 @@ int logwrap_fork_execvp(int argc, const char* const* argv, int* status, bool for
 
         setsid();
 
-        int child_ptty = TEMP_FAILURE_RETRY(open(child_devname, O_RDWR | O_CLOEXEC));
-        if (child_ptty < 0) {
-            FATAL_CHILD("Cannot open child_ptty: %s\n", strerror(errno));
+        int child_out = child_write;
+        if (child_out < 0) {
+            child_out = TEMP_FAILURE_RETRY(open(pty.devname, O_RDWR | O_CLOEXEC));
+            if (child_out < 0) {
+                FATAL_CHILD("Cannot open child_ptty: %s\n", strerror(errno));
+            }
         }
-        close(parent_ptty);
+        close(parent_read);
 
-        dup2(child_ptty, 1);
-        dup2(child_ptty, 2);
-        close(child_ptty);
+        dup2(child_out, 1);
+        dup2(child_out, 2);
+        close(child_out);
 
         child(argc, argv);
     } else {
+        // The child has its own copies now; parent() only sees POLLHUP once they're closed.
+        if (child_write >= 0) {
+            close(child_write);
+            child_write = -1;
+        }
+        if (parent_slave >= 0) {
+            close(parent_slave);
+            parent_slave = -1;
+        }
+
         if (forward_signals) {
             setup_signal_handlers(pid);
             unblock_signals(&oldset);
         }
 
-        rc = parent(argv[0], parent_ptty, pid, status, log_target, abbreviated, file_path,
-                    forward_signals);
+        rc = parent(argv[0], parent_read, pid, status, log_target, abbreviated, file_path,
+                    forward_signals, options);
 
         if (forward_signals) {
             restore_signal_handlers();
@@ -606,8 +894,18 @@ err_fork:
     if (forward_signals) {
         unblock_signals(&oldset);
     }
+    if (child_write >= 0) {
+        close(child_write);
+    }
+    if (parent_slave >= 0) {
+        close(parent_slave);
+    }
 err_ptty:
-    close(parent_ptty);
+    if (pool) {
+        pool_put_pty(pool, &pty);
+    } else {
+        close(parent_read);
+    }
 err_open:
     pthread_mutex_unlock(&fd_mutex);
 err_lock:
@@ -16,17 +16,98 @@
 
 #include "logwrap/logwrap.h"
 
+#include <string.h>
+#include <sys/mman.h>
+
+#include <string>
+
 #include <android-base/logging.h>
 #include <benchmark/benchmark.h>
 
-static void BM_android_fork_execvp_ext(benchmark::State& state) {
+// Grows the process by state.range(0) MB of touched memory, standing in for
+// a large daemon: fork() has to copy page tables for all of it.
+class ResidentMemory {
+  public:
+    explicit ResidentMemory(size_t mb) : size_(mb << 20) {
+        if (size_ == 0) return;
+        mem_ = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        CHECK_NE(MAP_FAILED, mem_);
+        memset(mem_, 1, size_);
+    }
+    ~ResidentMemory() {
+        if (size_ != 0) munmap(mem_, size_);
+    }
+
+  private:
+    size_t size_;
+    void* mem_ = nullptr;
+};
+
+static void BM_android_fork_execvp_ext(benchmark::State& state, unsigned flags) {
+    ResidentMemory rss(state.range(0));
+    const char* argv[] = {"/system/bin/echo", "hello", "world"};
+    const int argc = 3;
+    struct logwrap_options options = {.flags = flags};
+    while (state.KeepRunning()) {
+        int rc = logwrap_fork_execvp_ext(argc, argv, nullptr, false, LOG_NONE, false, nullptr,
+                                         &options);
+        CHECK_EQ(0, rc);
+    }
+}
+BENCHMARK_CAPTURE(BM_android_fork_execvp_ext, fork, 0u)->Arg(0)->Arg(10)->Arg(100)->Arg(1000);
+BENCHMARK_CAPTURE(BM_android_fork_execvp_ext, spawn, LOGWRAP_SPAWN)
+        ->Arg(0)->Arg(10)->Arg(100)->Arg(1000);
+
+// The cost of the capture channel: a new pty for each call, a pipe, or a pty
+// reused from a pool. The child is spawned so that its start-up cost, which
+// all three share, doesn't drown out the difference.
+static void BM_logwrap_capture(benchmark::State& state, unsigned flags, bool pooled) {
+    struct logwrap_pool* pool = nullptr;
+    if (pooled) {
+        pool = logwrap_pool_create(1);
+        CHECK(pool != nullptr);
+    }
     const char* argv[] = {"/system/bin/echo", "hello", "world"};
     const int argc = 3;
+    struct logwrap_options options = {.flags = flags, .pool = pool};
+    while (state.KeepRunning()) {
+        int rc = logwrap_fork_execvp_ext(argc, argv, nullptr, false, LOG_NONE, false, nullptr,
+                                         &options);
+        CHECK_EQ(0, rc);
+    }
+    logwrap_pool_destroy(pool);
+}
+BENCHMARK_CAPTURE(BM_logwrap_capture, pty, LOGWRAP_SPAWN, false);
+BENCHMARK_CAPTURE(BM_logwrap_capture, pipe, LOGWRAP_SPAWN | LOGWRAP_CAPTURE_PIPE, false);
+BENCHMARK_CAPTURE(BM_logwrap_capture, pool, LOGWRAP_SPAWN, true);
+
+// A chatty child: seq prints state.range(0) short lines as fast as it can,
+// so the cost is dominated by splitting and logging its output.
+static void BM_logwrap_chatty_child(benchmark::State& state, int log_target) {
+    std::string lines = std::to_string(state.range(0));
+    const char* argv[] = {"/system/bin/seq", "1", lines.c_str()};
+    const int argc = 3;
+    while (state.KeepRunning()) {
+        int rc = logwrap_fork_execvp(argc, argv, nullptr, false, log_target, false, "/dev/null");
+        CHECK_EQ(0, rc);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_CAPTURE(BM_logwrap_chatty_child, none, LOG_NONE)->Arg(1000)->Arg(100000);
+BENCHMARK_CAPTURE(BM_logwrap_chatty_child, file, LOG_FILE)->Arg(1000)->Arg(100000);
+BENCHMARK_CAPTURE(BM_logwrap_chatty_child, alog, LOG_ALOG)->Arg(1000)->Arg(100000);
+
+// A child that writes long lines, which take several reads each.
+static void BM_logwrap_long_lines(benchmark::State& state) {
+    std::string script = "yes " + std::string(state.range(0), 'x') + " | head -n 1000";
+    const char* argv[] = {"/system/bin/sh", "-c", script.c_str()};
+    const int argc = 3;
     while (state.KeepRunning()) {
-        int rc = logwrap_fork_execvp(argc, argv, nullptr, false, LOG_NONE, false, nullptr);
+        int rc = logwrap_fork_execvp(argc, argv, nullptr, false, LOG_FILE, false, "/dev/null");
         CHECK_EQ(0, rc);
     }
+    state.SetBytesProcessed(state.iterations() * 1000 * (state.range(0) + 1));
 }
-BENCHMARK(BM_android_fork_execvp_ext);
+BENCHMARK(BM_logwrap_long_lines)->Arg(100)->Arg(4000);
 
 BENCHMARK_MAIN();